@@ -5,10 +5,14 @@
 #include "peripherals/Display.h"
 #include "peripherals/Drum.h"
 #include "peripherals/StatusLed.h"
+#include "utils/SettingsStore.h"
 
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
 
+#include <array>
+#include <string_view>
+
 namespace Doncon::Config {
 
 struct I2c {
@@ -21,6 +25,59 @@ struct I2c {
 namespace Default {
 
 const usb_mode_t usb_mode = USB_MODE_SWITCH_TATACON;
+const uint16_t usb_sof_lead_time_us = 250; // Reports are queued this long before the next USB frame starts
+
+// Polling interval in ms and report pacing in frames (0 = unpaced) per USB mode. Console
+// modes keep the timing they have been tested with, PC modes send changes immediately.
+const usb_timing_t usb_timing[USB_MODE_COUNT] = {
+    {1, 1},  // Switch Tatacon
+    {1, 1},  // Switch Horipad
+    {1, 1},  // Dualshock 3
+    {1, 1},  // PS4 Tatacon
+    {1, 1},  // Dualshock 4
+    {1, 0},  // Keyboard P1
+    {1, 0},  // Keyboard P2
+    {1, 1},  // Xbox 360
+    {1, 1},  // Xbox 360 Analog P1
+    {1, 1},  // Xbox 360 Analog P2
+    {1, 0},  // MIDI
+    {16, 0}, // Debug (CDC notification endpoint)
+};
+
+// Whether the vendor config interface is offered next to the controller, see tools/doncon_config.py.
+// Consoles might reject devices with unexpected interfaces, so it is only enabled for PC modes.
+const bool usb_config_interface[USB_MODE_COUNT] = {
+    false, // Switch Tatacon
+    false, // Switch Horipad
+    false, // Dualshock 3
+    false, // PS4 Tatacon
+    false, // Dualshock 4
+    true,  // Keyboard P1
+    true,  // Keyboard P2
+    false, // Xbox 360
+    false, // Xbox 360 Analog P1
+    false, // Xbox 360 Analog P2
+    true,  // MIDI
+    true,  // Debug
+};
+
+// Settings are kept in a journal at the end of the flash, its sectors are used round-robin to spread
+// the wear. With at least 2 sectors, the previous settings stay intact while a sector is erased.
+const uint8_t settings_journal_sectors = 4;
+
+// Profiles as shown in the menu, each of them holds a complete set of settings. Holding Select and
+// North, East, South or West while plugging in selects the first to fourth profile.
+constexpr std::array<std::string_view, Utils::SettingsStore::profile_count> settings_profile_names = {
+    "Profile 1",
+    "Profile 2",
+    "Profile 3",
+    "Profile 4",
+};
+
+// Settings are written to flash in separate erase and program steps, each of them stalls both cores.
+const uint32_t settings_commit_idle_ms = 500;     // Steps only start once there has been no input for this long
+const uint32_t settings_commit_step_gap_ms = 20;  // Minimum time between steps, keeps USB serviced
+const uint32_t settings_commit_budget_us = 50000; // Steps blocking longer than this are reported as over budget
 
 const I2c i2c_config = {
     6,       // SDA Pin
@@ -66,13 +123,7 @@ const Peripherals::Drum::Config drum_config = {
 };
 
 const Peripherals::Buttons::Config button_config = {
-    // I2c config
-    {
-        i2c_config.block, // Block
-        0x20,             // Address
-    },
-
-    // Pins
+    // Pins, either RP2040 GPIOs or MCP23017 pins depending on the GPIO config below
     {{
          8,  // Up
          9,  // Down
@@ -94,7 +145,19 @@ const Peripherals::Buttons::Config button_config = {
          14, // Share
      }},
 
-    25, // Debounce delay in milliseconds
+    25,                                       // Debounce delay in milliseconds
+    Peripherals::Buttons::SocdMode::LastWins, // SOCD mode, LastWins, FirstWins, Neutral or UpPriority
+
+    // GPIO Config, either InternalGpio or ExternalGpio
+    //
+    // Peripherals::Buttons::Config::InternalGpio{},
+
+    Peripherals::Buttons::Config::ExternalGpio{
+        i2c_config.block, // Block
+        0x20,             // Address
+        // Interrupt Pin (INTA/INTB, mirrored), or no_interrupt_pin to read the expander continuously
+        Peripherals::Buttons::Config::ExternalGpio::no_interrupt_pin,
+    },
 };
 
 const Peripherals::StatusLed::Config led_config = {
@@ -6,20 +6,35 @@
 #include "hardware/i2c.h"
 #include <mcp23017/Mcp23017.h>
 
-#include <map>
+#include <array>
 #include <memory>
 #include <stdint.h>
+#include <variant>
 
 namespace Doncon::Peripherals {
 
 class Buttons {
   public:
+    // How to resolve simultaneous opposite directions on the dpad.
+    enum class SocdMode : uint8_t {
+        LastWins,
+        FirstWins,
+        Neutral,
+        UpPriority, // Up wins over down, left + right is neutral
+    };
+
     struct Config {
-        struct {
-            i2c_inst_t *block;
-            uint8_t address;
-        } i2c;
+        struct InternalGpio {};
 
+        struct ExternalGpio {
+            const static uint8_t no_interrupt_pin = 0xFF;
+
+            i2c_inst_t *i2c_block;
+            uint8_t i2c_address;
+            uint8_t interrupt_pin;
+        };
+
+        // Either RP2040 GPIO numbers or MCP23017 pins (0-15), depending on gpio_config.
         struct {
             struct {
                 uint8_t up;
@@ -45,6 +60,9 @@ class Buttons {
         } pins;
 
         uint8_t debounce_delay_ms;
+        SocdMode socd_mode;
+
+        std::variant<InternalGpio, ExternalGpio> gpio_config;
     };
 
   private:
@@ -65,34 +83,73 @@ class Buttons {
         SHARE,
     };
 
-    class Button {
+    // Debounces all pins of a port at once. A change is applied immediately, afterwards the pin is
+    // locked for the debounce delay. The remaining lockout of each pin is kept in a 3 bit vertical
+    // counter, i.e. bit n of each plane belongs to pin n, which is counted down in ticks of
+    // debounce_delay / 6. This gives a lockout between 1 and 7/6 of the debounce delay.
+    class Debouncer {
       private:
-        uint8_t gpio_pin;
-        uint16_t gpio_mask;
+        const static uint8_t m_lockout_ticks = 7;
+
+        uint32_t m_state;
+        uint32_t m_lockout[3];
+        uint32_t m_last_tick_us;
+
+        void tick();
+
+      public:
+        Debouncer();
+
+        uint32_t update(const uint32_t raw, const uint32_t now_us, const uint8_t debounce_delay_ms);
+    };
+
+    class GpioInterface {
+      public:
+        // Bit n is set if pin n is pressed
+        virtual uint32_t read() = 0;
+    };
 
-        uint32_t last_change;
-        bool active;
+    class InternalGpio : public GpioInterface {
+      private:
+        uint32_t m_pin_mask;
 
       public:
-        Button(uint8_t pin);
+        InternalGpio(const Config::InternalGpio &config, const uint32_t pin_mask);
+        virtual uint32_t read() final;
+    };
 
-        uint8_t getGpioPin() const { return gpio_pin; };
-        uint16_t getGpioMask() const { return gpio_mask; };
+    class ExternalGpio : public GpioInterface {
+      private:
+        // Fallback in case an edge on the interrupt line gets lost.
+        const static uint32_t m_poll_interval_ms = 10;
+
+        Mcp23017 m_mcp23017;
+        bool m_use_interrupt;
+        uint16_t m_gpio_state;
+        uint32_t m_last_read;
 
-        bool getState() const { return active; };
-        void setState(bool state, uint8_t debounce_delay);
+      public:
+        ExternalGpio(const Config::ExternalGpio &config);
+        virtual uint32_t read() final;
     };
 
+    // Directions of an axis are encoded as bit 0 for up/left and bit 1 for down/right.
     struct SocdState {
-        Id lastVertical;
-        Id lastHorizontal;
+        struct Axis {
+            uint8_t previous_input;
+            uint8_t previous_output;
+        };
+
+        Axis vertical;
+        Axis horizontal;
     };
 
     Config m_config;
     SocdState m_socd_state;
-    std::map<Id, Button> m_buttons;
+    Debouncer m_debouncer;
+    std::array<uint32_t, 14> m_pin_masks;
 
-    std::unique_ptr<Mcp23017> m_mcp23017;
+    std::unique_ptr<GpioInterface> m_gpio;
 
     void socdClean(Utils::InputState &input_state);
 
@@ -100,6 +157,8 @@ class Buttons {
     Buttons(const Config &config);
 
     void updateInputState(Utils::InputState &input_state);
+
+    void setSocdMode(const SocdMode mode);
 };
 
 } // namespace Doncon::Peripherals
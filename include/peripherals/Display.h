@@ -3,12 +3,16 @@
 
 #include "usb/device_driver.h"
 #include "utils/InputState.h"
+#include "utils/LatencyTracker.h"
+#include "utils/LoopProfiler.h"
 #include "utils/Menu.h"
 
 #include <ssd1306/ssd1306.h>
 
 #include "hardware/i2c.h"
+#include "pico/util/queue.h"
 
+#include <array>
 #include <memory>
 #include <stdint.h>
 
@@ -34,12 +38,27 @@ class Display {
     usb_mode_t m_usb_mode;
     uint8_t m_player_id;
 
+    // Raw levels of each pad latched between frames. Don left, Ka left, Don right, Ka right.
+    struct PadLevel {
+        uint16_t frame_max; // Highest level since the last frame
+        uint16_t peak;      // Held for a while so single hits can be read
+        uint32_t peak_since_ms;
+        uint32_t triggered_ms;
+    };
+    std::array<PadLevel, 4> m_pad_levels;
+
     Utils::Menu::State m_menu_state;
+    Utils::LatencyTracker::Report m_latency_report;
+    std::array<Utils::LoopProfiler::Report, 2> m_loop_reports;
 
     ssd1306_t m_display;
+    uint8_t m_next_page; // Next page to transfer, equals the page count if the frame is complete
 
     void drawIdleScreen();
     void drawMenuScreen();
+    void drawThresholdMeter(const PadLevel &level, uint16_t threshold, uint16_t max_value);
+    void drawLatencyPage();
+    void drawLoopProfilePage();
 
   public:
     Display(const Config &config);
@@ -48,12 +67,22 @@ class Display {
     void setUsbMode(usb_mode_t mode);
     void setPlayerId(uint8_t player_id);
 
+    // Needs to be called for every drum update, since hits are shorter than the time between frames.
+    void trackDrum(const Utils::InputState::Drum &drum);
+
     void setMenuState(const Utils::Menu::State &menu_state);
+    // Reports are received straight from their queue, another copy would not fit on core1's stack.
+    void receiveLatencyReport(queue_t *queue);
+    void receiveLoopReport(uint8_t core, queue_t *queue);
+    void setLoopReport(uint8_t core, const Utils::LoopProfiler::Report &report);
 
     void showIdle();
     void showMenu();
 
+    // Renders a new frame unless the previous one is still being transferred.
     void update();
+    // Transfers a single page of the current frame, returns false if there is nothing left to send.
+    bool transfer();
 };
 
 } // namespace Doncon::Peripherals
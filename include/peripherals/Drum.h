@@ -8,7 +8,6 @@
 #include <mcp3204/Mcp3204Dma.h>
 
 #include <array>
-#include <map>
 #include <memory>
 #include <stdint.h>
 #include <variant>
@@ -55,6 +54,14 @@ class Drum {
         std::variant<InternalAdc, ExternalAdc> adc_config;
     };
 
+    // Acquisition rates over the last second
+    struct AdcStats {
+        std::array<uint32_t, 4> conversions_per_s; // By ADC channel
+        uint32_t irqs_per_s;
+        uint32_t irq_load_permille; // Share of CPU time spent in the ADC's interrupt handlers
+        uint32_t max_cycle_us;      // Longest time for reading all channels once
+    };
+
   private:
     enum class Id {
         DON_LEFT,
@@ -63,6 +70,16 @@ class Drum {
         KA_RIGHT,
     };
 
+    // Fixed size replacement for a std::map<Id, T>, so the hot path neither allocates nor runs tree code from flash.
+    template <typename T> struct ById {
+        std::array<T, 4> values;
+
+        T &operator[](const Id id) { return values[static_cast<size_t>(id)]; }
+        const T &operator[](const Id id) const { return values[static_cast<size_t>(id)]; }
+    };
+
+    constexpr static std::array<Id, 4> pad_ids = {Id::DON_LEFT, Id::KA_LEFT, Id::DON_RIGHT, Id::KA_RIGHT};
+
     class Pad {
       private:
         uint8_t channel;
@@ -77,19 +94,48 @@ class Drum {
         void setState(const bool state, const uint16_t debounce_delay);
     };
 
+    // Maximum of the raw values within the debounce window, kept at millisecond resolution.
+    struct PeakWindow {
+        const static size_t capacity = 256; // Covers every debounce delay which can be set in the menu
+
+        struct Entry {
+            uint16_t value;
+            uint16_t timestamp_ms; // Truncated, only used for differences
+        };
+
+        std::array<Entry, capacity> entries;
+        size_t head;
+        size_t count;
+
+        void update(const uint16_t value, const uint32_t now_ms, const uint16_t window_ms);
+        uint16_t getMax() const;
+    };
+
     class AdcInterface {
       public:
-        // Those are expected to be 12bit values
-        virtual std::array<uint16_t, 4> read() = 0;
+        // Free running counters, which are allowed to wrap around.
+        struct Counters {
+            std::array<uint32_t, 4> conversions;
+            uint32_t irqs;
+            uint32_t irq_busy_us;
+            uint32_t max_cycle_us; // Since the last call
+        };
+
+        // Those are expected to be 12bit values, sample times are in microseconds since boot.
+        virtual std::array<uint16_t, 4> read(std::array<uint32_t, 4> &sample_times_us) = 0;
+        virtual Counters takeCounters() = 0;
     };
 
     class InternalAdc : public AdcInterface {
       private:
         Config::InternalAdc m_config;
+        Counters m_counters;
+        uint32_t m_cycle_start_us;
 
       public:
         InternalAdc(const Config::InternalAdc &config);
-        virtual std::array<uint16_t, 4> read() final;
+        virtual std::array<uint16_t, 4> read(std::array<uint32_t, 4> &sample_times_us) final;
+        virtual Counters takeCounters() final;
     };
 
     class ExternalAdc : public AdcInterface {
@@ -98,18 +144,26 @@ class Drum {
 
       public:
         ExternalAdc(const Config::ExternalAdc &config);
-        virtual std::array<uint16_t, 4> read() final;
+        virtual std::array<uint16_t, 4> read(std::array<uint32_t, 4> &sample_times_us) final;
+        virtual Counters takeCounters() final;
     };
 
     Config m_config;
     std::unique_ptr<AdcInterface> m_adc;
-    std::map<Id, Pad> m_pads;
+    ById<Pad> m_pads;
+    std::array<uint32_t, 4> m_sample_times_us;
+
+    AdcInterface::Counters m_adc_counters;
+    uint32_t m_adc_stats_start_us;
+    AdcStats m_adc_stats;
+
+    void updateAdcStats();
 
   private:
     void updateRollCounter(Utils::InputState &input_state);
-    void updateDigitalInputState(Utils::InputState &input_state, const std::map<Id, uint16_t> &raw_values);
-    void updateAnalogInputState(Utils::InputState &input_state, const std::map<Id, uint16_t> &raw_values);
-    std::map<Id, uint16_t> readInputs();
+    void updateDigitalInputState(Utils::InputState &input_state, const ById<uint16_t> &raw_values);
+    void updateAnalogInputState(Utils::InputState &input_state, const ById<uint16_t> &raw_values);
+    ById<uint16_t> readInputs();
 
   public:
     Drum(const Config &config);
@@ -118,6 +172,8 @@ class Drum {
 
     void setDebounceDelay(const uint16_t delay);
     void setThresholds(const Config::Thresholds &thresholds);
+
+    AdcStats getAdcStats() const { return m_adc_stats; };
 };
 
 } // namespace Doncon::Peripherals
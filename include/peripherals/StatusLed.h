@@ -36,6 +36,7 @@ class StatusLed {
 
     Utils::InputState m_input_state;
     std::optional<Config::Color> m_player_color;
+    std::optional<uint32_t> m_pixel;
 
   public:
     StatusLed(const Config &config);
@@ -46,6 +47,7 @@ class StatusLed {
     void setInputState(const Utils::InputState input_state);
     void setPlayerColor(const Config::Color color);
 
+    // Only pushes to the LED if the color actually changed.
     void update();
 };
 
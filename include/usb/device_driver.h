@@ -10,6 +10,9 @@
 
 #define USBD_MAX_POWER_MAX (500)
 
+#define USBD_SOF_AGE_BUCKET_US (100)
+#define USBD_SOF_AGE_BUCKET_COUNT (11) // Last bucket collects everything older than a frame
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,6 +32,8 @@ typedef enum {
     USB_MODE_DEBUG,
 } usb_mode_t;
 
+#define USB_MODE_COUNT (USB_MODE_DEBUG + 1)
+
 enum {
     USBD_STR_LANGUAGE,
     USBD_STR_MANUFACTURER,
@@ -51,6 +56,8 @@ typedef struct {
     const uint8_t *desc_bos;
     // Callbacks
     bool (*send_report)(usb_report_t report);
+    // Unchanged reports are not sent again unless the host expects them periodically, 0 to disable
+    uint16_t keepalive_ms;
 } usbd_driver_t;
 
 typedef enum {
@@ -70,6 +77,31 @@ typedef struct {
     };
 } usb_player_led_t;
 
+// Time between a report being queued and the following SOF
+typedef struct {
+    uint32_t buckets[USBD_SOF_AGE_BUCKET_COUNT];
+    uint32_t max_us;
+} usbd_sof_age_histogram_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t keepalive; // Unchanged reports sent because the keep-alive interval elapsed
+    uint32_t unchanged; // Unchanged reports which were not sent
+    uint32_t failed;    // Reports which could not be queued, e.g. because the endpoint was busy
+} usbd_report_stats_t;
+
+typedef struct {
+    uint8_t interval_ms;   // bInterval of all interrupt IN endpoints
+    uint8_t pacing_frames; // At most one report every n frames synchronized to SOF, 0 sends changes immediately
+} usb_timing_t;
+
+// Timing of the most recent report which differed from its predecessor, in microseconds since boot
+typedef struct {
+    uint32_t queued_us;
+    uint32_t completed_us; // Transfer to the host finished, only valid if completed is set
+    bool completed;
+} usbd_report_timing_t;
+
 extern char *const usbd_desc_str[];
 
 typedef void (*usbd_player_led_cb_t)(usb_player_led_t);
@@ -77,10 +109,25 @@ typedef void (*usbd_player_led_cb_t)(usb_player_led_t);
 void usbd_driver_init(usb_mode_t mode);
 void usbd_driver_task();
 
+// Re-enumerates with the driver of another mode, also applies a changed polling interval.
+void usbd_driver_switch_mode(usb_mode_t mode);
+// Time from the start of the last mode switch until the host configured the device, in microseconds
+uint32_t usbd_driver_get_last_switch_time();
+
 usb_mode_t usbd_driver_get_mode();
 
+// Paced reports are sent lead_us before the next expected SOF.
+void usbd_driver_set_sof_lead_time(uint16_t lead_us);
+// Adds the config interface next to the mode's own interfaces, applied on the next enumeration.
+void usbd_driver_set_config_interface(bool enable);
+// The interval is applied on the next enumeration, pacing immediately.
+void usbd_driver_set_timing(usb_timing_t timing);
 void usbd_driver_send_report(usb_report_t report);
 
+void usbd_driver_get_sof_age_histogram(usbd_sof_age_histogram_t *histogram, bool reset);
+void usbd_driver_get_report_stats(usbd_report_stats_t *stats);
+void usbd_driver_get_report_timing(usbd_report_timing_t *timing);
+
 void usbd_driver_set_player_led_cb(usbd_player_led_cb_t cb);
 usbd_player_led_cb_t usbd_driver_get_player_led_cb();
 
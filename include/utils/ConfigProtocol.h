@@ -0,0 +1,62 @@
+#ifndef _UTILS_CONFIGPROTOCOL_H_
+#define _UTILS_CONFIGPROTOCOL_H_
+
+#include "utils/InputState.h"
+#include "utils/SettingsStore.h"
+
+#include <memory>
+#include <stdint.h>
+
+namespace Doncon::Utils {
+
+// Maps the requests of the USB config interface to the settings store and streams the live drum state.
+// The protocol itself is described in usb/device/vendor/config_driver.h.
+class ConfigProtocol {
+  public:
+    // Values of indexed fields are selected by the high byte of wValue.
+    enum class Field : uint8_t {
+        ActiveProfile = 0x00,        // uint8_t
+        UsbMode = 0x01,              // uint8_t usb_mode_t, applied on commit
+        TriggerThresholds = 0x02,    // uint16_t don_left, ka_left, don_right, ka_right
+        LedBrightness = 0x03,        // uint8_t
+        LedEnablePlayerColor = 0x04, // uint8_t
+        DebounceDelay = 0x05,        // uint16_t, at most 255
+        SocdMode = 0x06,             // uint8_t
+        UsbTiming = 0x07,            // uint8_t interval_ms, pacing_frames, indexed by usb_mode_t
+    };
+
+    struct __attribute((packed, aligned(1))) StreamFrame {
+        uint8_t sequence;
+        uint8_t triggered; // Bit per pad in the order below
+        uint32_t timestamp_us;
+        struct __attribute((packed, aligned(1))) {
+            uint16_t raw;
+            uint16_t analog;
+        } pads[4]; // Don left, Ka left, Don right, Ka right
+    };
+
+  private:
+    std::shared_ptr<SettingsStore> m_store;
+    bool m_changed;
+    bool m_commit_requested;
+    uint8_t m_sequence;
+
+    static uint16_t handleGet(uint8_t field, uint8_t index, uint8_t *data, uint16_t max_length);
+    static bool handleSet(uint8_t field, uint8_t index, const uint8_t *data, uint16_t length);
+    static void handleCommit();
+
+  public:
+    // Only one instance can be registered with the USB driver at a time.
+    ConfigProtocol(std::shared_ptr<SettingsStore> settings_store);
+
+    void stream(const InputState::Drum &drum);
+
+    // Returns true once after the host changed a setting.
+    bool takeChanged();
+    // Returns true once after the host requested the settings to be stored.
+    bool takeCommitRequest();
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_CONFIGPROTOCOL_H_
@@ -0,0 +1,14 @@
+#ifndef _UTILS_CRC32_H_
+#define _UTILS_CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Doncon::Utils {
+
+// CRC-32 as used by zlib and PNG. Pass the previous result as crc to continue a calculation.
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_CRC32_H_
@@ -0,0 +1,57 @@
+#ifndef _UTILS_DEBUGCONSOLE_H_
+#define _UTILS_DEBUGCONSOLE_H_
+
+#include "peripherals/Drum.h"
+#include "utils/InputState.h"
+#include "utils/LatencyTracker.h"
+#include "utils/LoopProfiler.h"
+#include "utils/Scheduler.h"
+#include "utils/SettingsImport.h"
+#include "utils/SettingsStore.h"
+
+#include "pico/util/queue.h"
+
+#include <memory>
+
+namespace Doncon::Utils {
+
+// Single character commands on the USB serial console in debug mode, see README.md for the list.
+// Diagnostics are printed as formatted text and therefore allocate.
+class DebugConsole {
+  public:
+    // Reports which are only available from core1.
+    struct Queues {
+        queue_t *scheduler_report;
+        queue_t *core1_loop_report;
+    };
+
+  private:
+    std::shared_ptr<SettingsStore> m_store;
+    Peripherals::Drum &m_drum;
+    InputState &m_input_state;
+    LatencyTracker &m_latency_tracker;
+    LoopProfiler &m_loop_profiler;
+    Queues m_queues;
+
+    Scheduler::Report m_scheduler_report;
+    LoopProfiler::Report m_core1_loop_report;
+    SettingsImport m_settings_import;
+    bool m_imported;
+
+    void receiveImport();
+    void processCommand(int command);
+
+  public:
+    DebugConsole(std::shared_ptr<SettingsStore> settings_store, Peripherals::Drum &drum, InputState &input_state,
+                 LatencyTracker &latency_tracker, LoopProfiler &loop_profiler, const Queues &queues);
+
+    // Handles the input received so far without blocking.
+    void update();
+
+    // Returns true once after settings have been imported, they still need to be stored and applied.
+    bool takeImported();
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_DEBUGCONSOLE_H_
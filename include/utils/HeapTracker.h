@@ -0,0 +1,57 @@
+#ifndef _UTILS_HEAPTRACKER_H_
+#define _UTILS_HEAPTRACKER_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Faults on heap allocations within hot loop regions if enabled, e.g. via `cmake -DDONCON_HEAP_GUARD=ON`.
+#ifndef DONCON_HEAP_GUARD
+#define DONCON_HEAP_GUARD 0
+#endif
+
+namespace Doncon::Utils {
+
+// Counts C++ heap allocations per core and per region of the code. Each core is in exactly one region at a time.
+class HeapTracker {
+  public:
+    enum class Region : uint8_t {
+        Startup,
+        Drum,       // Hot loop, guarded
+        Usb,        // Hot loop, guarded
+        Menu,
+        Debug,
+        Core1Io,    // Buttons, LED and control messages, guarded
+        Display,    // Rendering on core1, guarded
+    };
+
+    const static size_t region_count = 7;
+    const static size_t core_count = 2;
+
+    struct Counters {
+        uint32_t allocations;
+        uint32_t frees;
+        uint32_t allocated_bytes;
+    };
+
+    struct Report {
+        std::array<std::array<Counters, region_count>, core_count> counters;
+        uint32_t current_bytes;
+        uint32_t peak_bytes;
+        uint32_t startup_peak_bytes; // Peak at the time the startup has been marked as complete
+        uint32_t heap_size;          // Total heap available to malloc()
+        uint32_t heap_used;          // Including C allocations and allocator overhead
+    };
+
+    static const char *getRegionName(Region region);
+
+    // Applies to the calling core.
+    static void setRegion(Region region);
+    static void markStartupComplete();
+
+    static Report getReport();
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_HEAPTRACKER_H_
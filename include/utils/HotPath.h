@@ -0,0 +1,19 @@
+#ifndef _UTILS_HOTPATH_H_
+#define _UTILS_HOTPATH_H_
+
+#include "pico/platform.h"
+
+// Functions on the path from ADC sample to USB report are copied to SRAM at boot, so they don't stall on
+// XIP cache misses caused by other code running from flash. Can be disabled for comparison via
+// `cmake -DDONCON_HOT_PATH_IN_RAM=OFF`, see tools/sram_report.py for the resulting SRAM usage.
+#ifndef DONCON_HOT_PATH_IN_RAM
+#define DONCON_HOT_PATH_IN_RAM 1
+#endif
+
+#if DONCON_HOT_PATH_IN_RAM
+#define DONCON_HOT_FUNC(func_name) __not_in_flash_func(func_name)
+#else
+#define DONCON_HOT_FUNC(func_name) func_name
+#endif
+
+#endif // _UTILS_HOTPATH_H_
@@ -9,6 +9,8 @@
 #include "usb/device/vendor/xinput_driver.h"
 #include "usb/device_driver.h"
 
+#include <array>
+#include <optional>
 #include <stdint.h>
 #include <string>
 
@@ -16,6 +18,11 @@ namespace Doncon::Utils {
 
 struct InputState {
   public:
+    struct ReportStats {
+        uint32_t encoded;
+        uint32_t skipped; // Reports which were reused since no relevant input changed
+    };
+
     struct Drum {
         struct Pad {
             bool triggered;
@@ -26,6 +33,10 @@ struct InputState {
         Pad don_left, ka_left, don_right, ka_right;
         uint16_t current_roll;
         uint16_t previous_roll;
+
+        // ADC sample and detection time of the most recent hit in microseconds since boot
+        uint32_t hit_sample_us;
+        uint32_t hit_detect_us;
     };
 
     struct Controller {
@@ -62,6 +73,18 @@ struct InputState {
     midi_report_t m_midi_report;
     std::string m_debug_report;
 
+    std::optional<usb_mode_t> m_last_mode;
+    uint32_t m_last_digital_state;
+    std::array<uint16_t, 4> m_last_analog_state;
+    uint16_t m_last_report_size;
+    uint32_t m_last_encode_us;
+    ReportStats m_report_stats;
+
+    uint32_t getDigitalState() const;
+    std::array<uint16_t, 4> getAnalogState() const;
+    uint8_t *getReportBuffer(usb_mode_t mode);
+    usb_report_t buildReport(usb_mode_t mode);
+
     usb_report_t getSwitchReport();
     usb_report_t getPS3InputReport();
     usb_report_t getPS4InputReport();
@@ -75,9 +98,15 @@ struct InputState {
   public:
     InputState();
 
+    // Only encodes a new report if any input relevant for the mode changed.
     usb_report_t getReport(usb_mode_t mode);
+    ReportStats getReportStats() const { return m_report_stats; };
+    uint32_t getLastEncodeTime() const { return m_last_encode_us; };
+    bool anyPressed() const { return getDigitalState() != 0; };
 
     void releaseAll();
+    // Forces the next report to be encoded from scratch, e.g. after the USB mode changed.
+    void resetReports();
 
     bool checkHotkey();
 };
@@ -0,0 +1,74 @@
+#ifndef _UTILS_LATENCYTRACKER_H_
+#define _UTILS_LATENCYTRACKER_H_
+
+#include "utils/InputState.h"
+
+#include <array>
+#include <stdint.h>
+
+namespace Doncon::Utils {
+
+// Follows one drum hit at a time from its ADC sample until the report containing it
+// has been transferred to the host and collects the time spent in each stage.
+class LatencyTracker {
+  public:
+    enum class Span {
+        SampleToDetect,
+        DetectToEncode,
+        EncodeToQueue,
+        QueueToComplete,
+        Total,
+    };
+
+    const static size_t span_count = 5;
+    const static uint32_t bucket_us = 250;
+    const static size_t bucket_count = 17; // Last bucket collects everything from 4ms
+
+    struct Histogram {
+        std::array<uint32_t, bucket_count> buckets;
+        uint32_t count;
+        uint32_t min_us;
+        uint32_t max_us;
+        uint64_t sum_us;
+    };
+
+    struct Report {
+        std::array<Histogram, span_count> spans;
+        uint32_t dropped; // Hits which did not reach the host within the timeout
+    };
+
+  private:
+    enum class Stage {
+        Idle,
+        Detected,
+        Encoded,
+        Queued,
+    };
+
+    const static uint32_t m_timeout_us = 100000;
+
+    Stage m_stage;
+    uint32_t m_last_detect_us;
+
+    uint32_t m_sample_us;
+    uint32_t m_detect_us;
+    uint32_t m_encode_us;
+    uint32_t m_queue_us;
+
+    Report m_report;
+
+    void record(Span span, uint32_t from_us, uint32_t to_us);
+
+  public:
+    LatencyTracker();
+
+    // Needs to be called after the report has been handed to the USB driver.
+    void update(const InputState &input_state);
+
+    Report getReport() const { return m_report; };
+    void reset();
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_LATENCYTRACKER_H_
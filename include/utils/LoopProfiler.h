@@ -0,0 +1,48 @@
+#ifndef _UTILS_LOOPPROFILER_H_
+#define _UTILS_LOOPPROFILER_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Doncon::Utils {
+
+// Measures the time between consecutive calls to tick(), i.e. the duration of each loop iteration, and the
+// jitter, i.e. how much the duration changed from one iteration to the next. Statistics are collected over
+// fixed windows, the report always covers the last complete window.
+class LoopProfiler {
+  public:
+    const static size_t bucket_count = 16; // Bucket n counts values from 2^n us, bucket 0 also below 1us
+
+    struct Report {
+        uint32_t iterations;
+        uint32_t min_us;
+        uint32_t max_us;
+        uint32_t max_jitter_us; // Largest difference between two consecutive iterations
+        uint64_t sum_us;
+        std::array<uint32_t, bucket_count> buckets;        // Iteration durations
+        std::array<uint32_t, bucket_count> jitter_buckets; // Differences between consecutive iterations
+    };
+
+  private:
+    uint32_t m_window_us;
+    uint32_t m_last_tick_us;
+    uint32_t m_last_duration_us;
+    bool m_started;
+
+    Report m_current;
+    Report m_report;
+
+    void reset(Report &report);
+
+  public:
+    LoopProfiler(const uint32_t window_us = 1000000);
+
+    void tick();
+
+    Report getReport() const { return m_report; };
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_LOOPPROFILER_H_
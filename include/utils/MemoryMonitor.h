@@ -0,0 +1,41 @@
+#ifndef _UTILS_MEMORYMONITOR_H_
+#define _UTILS_MEMORYMONITOR_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Doncon::Utils {
+
+// Measures the stack high-water mark of both cores by painting the unused part of each stack with a
+// known pattern and later checking how much of it has been overwritten. Also reports the SRAM layout.
+class MemoryMonitor {
+  public:
+    const static size_t core_count = 2;
+
+    struct Stack {
+        uint32_t size;
+        uint32_t used;   // High-water mark
+        bool overflowed; // The lowest word has been overwritten, the actual usage is unknown
+    };
+
+    struct Report {
+        std::array<Stack, core_count> stacks;
+        uint32_t data_bytes; // Including the functions copied to SRAM
+        uint32_t bss_bytes;
+        uint32_t heap_size; // Space between the end of bss and the top of the main RAM
+    };
+
+  private:
+    const static uint32_t m_paint_pattern = 0x5AFE57AC;
+
+  public:
+    // Needs to be called on each core as early as possible, only paints below the current stack pointer.
+    static void paintStack();
+
+    static Report getReport();
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_MEMORYMONITOR_H_
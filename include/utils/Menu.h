@@ -4,11 +4,10 @@
 #include "utils/InputState.h"
 #include "utils/SettingsStore.h"
 
-#include <map>
+#include <array>
 #include <memory>
 #include <stack>
-#include <string>
-#include <vector>
+#include <string_view>
 
 namespace Doncon::Utils {
 
@@ -17,21 +16,32 @@ class Menu {
     enum class Page {
         Main,
 
+        Profile,
         DeviceMode,
+        Usb,
         Drum,
+        Buttons,
         Led,
+        Latency,
         Reset,
         Bootsel,
 
+        UsbInterval,
+        UsbPacing,
+
         DrumDebounceDelay,
         DrumTriggerThresholdKaLeft,
         DrumTriggerThresholdDonLeft,
         DrumTriggerThresholdDonRight,
         DrumTriggerThresholdKaRight,
 
+        ButtonsSocdMode,
+
         LedBrightness,
         LedEnablePlayerColor,
 
+        LoopProfile,
+
         BootselMsg,
     };
 
@@ -39,6 +49,15 @@ class Menu {
         Page page;
         uint16_t selected_value;
         uint16_t original_value;
+        bool coarse; // Value pages step in larger increments, toggled by L/R
+    };
+
+    const static size_t page_count = static_cast<size_t>(Page::BootselMsg) + 1;
+
+    // Reads and writes the setting edited on a page, values are indices for Selection pages.
+    struct Binding {
+        uint16_t (*get)(SettingsStore &store);
+        void (*set)(SettingsStore &store, uint16_t value);
     };
 
     struct Descriptor {
@@ -47,50 +66,38 @@ class Menu {
             Selection,
             Value,
             Toggle,
+            Info,
             RebootInfo,
         };
 
         enum class Action {
             None,
             GotoParent,
-
-            GotoPageDeviceMode,
-            GotoPageDrum,
-            GotoPageLed,
-            GotoPageReset,
-            GotoPageBootsel,
-
-            GotoPageDrumDebounceDelay,
-            GotoPageDrumTriggerThresholdKaLeft,
-            GotoPageDrumTriggerThresholdDonLeft,
-            GotoPageDrumTriggerThresholdDonRight,
-            GotoPageDrumTriggerThresholdKaRight,
-
-            GotoPageLedBrightness,
-            GotoPageLedEnablePlayerColor,
-
-            SetUsbMode,
-
-            SetDrumDebounceDelay,
-            SetDrumTriggerThresholdKaLeft,
-            SetDrumTriggerThresholdDonLeft,
-            SetDrumTriggerThresholdDonRight,
-            SetDrumTriggerThresholdKaRight,
-
-            SetLedBrightness,
-            SetLedEnablePlayerColor,
-
+            GotoPage,
+            SetValue,
             DoReset,
             DoRebootToBootsel,
         };
 
+        struct Item {
+            std::string_view name;
+            Action action;
+            Page target; // Only used by GotoPage
+        };
+
+        Page page;
         Type type;
-        std::string name;
-        std::vector<std::pair<std::string, Action>> items;
+        std::string_view name;
+        const Item *items;
+        uint8_t item_count;
         uint16_t max_value;
+        Binding binding;
     };
 
-    const static std::map<Page, const Descriptor> descriptors;
+    // Indexed by Page, lives in flash.
+    const static std::array<Descriptor, page_count> descriptors;
+
+    static const Descriptor &getDescriptor(Page page) { return descriptors[static_cast<size_t>(page)]; }
 
   private:
     std::shared_ptr<SettingsStore> m_store;
@@ -98,10 +105,11 @@ class Menu {
     std::stack<State> m_state_stack;
 
     uint16_t getCurrentValue(Page page);
+    void setValue(Page page, uint16_t value);
     void gotoPage(Page page);
     void gotoParent(bool do_restore);
 
-    void performAction(Descriptor::Action action, uint8_t value);
+    void performAction(const Descriptor::Item &item, uint16_t value);
 
   public:
     Menu(std::shared_ptr<SettingsStore> settings_store);
@@ -0,0 +1,58 @@
+#ifndef _UTILS_SCHEDULER_H_
+#define _UTILS_SCHEDULER_H_
+
+#include <array>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace Doncon::Utils {
+
+// Cooperative scheduler for periodic tasks. Each call to update() runs the first due task,
+// so tasks are prioritized in the order they have been added.
+class Scheduler {
+  public:
+    const static size_t max_tasks = 8;
+
+    struct Stats {
+        const char *name;
+        uint32_t period_us;
+        uint32_t deadline_us;
+
+        uint32_t runs;
+        uint32_t overruns; // Runs which finished after their deadline
+
+        uint32_t last_exec_us;
+        uint32_t max_exec_us;
+        uint32_t max_latency_us; // Time between a task becoming due and actually being started
+    };
+
+    struct Report {
+        uint8_t task_count;
+        std::array<Stats, max_tasks> tasks;
+    };
+
+  private:
+    struct Task {
+        std::function<void()> function;
+        uint32_t next_due_us;
+        Stats stats;
+    };
+
+    std::vector<Task> m_tasks;
+
+  public:
+    Scheduler();
+
+    // The deadline is relative to the time the task became due, 0 means the deadline equals the period.
+    void addTask(const char *name, const uint32_t period_us, std::function<void()> function,
+                 const uint32_t deadline_us = 0);
+
+    void update();
+
+    Report getReport() const;
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_SCHEDULER_H_
@@ -0,0 +1,47 @@
+#ifndef _UTILS_SETTINGSIMPORT_H_
+#define _UTILS_SETTINGSIMPORT_H_
+
+#include "utils/SettingsStore.h"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Doncon::Utils {
+
+// Collects a hex encoded settings blob terminated by a newline from stdio, as exported by
+// SettingsStore::exportSettings(). The line arrives over many loop iterations, so USB keeps being
+// serviced and the drum keeps being scanned.
+class SettingsImport {
+  public:
+    enum class Result {
+        Pending,
+        Complete,
+        Failed,
+    };
+
+  private:
+    const static uint32_t m_char_timeout_us = 1000000;
+
+    std::array<uint8_t, SettingsStore::blob_max_size> m_blob;
+    size_t m_digits;
+    bool m_valid;
+    bool m_active;
+    uint32_t m_last_char_us;
+
+  public:
+    SettingsImport();
+
+    void start();
+    bool active() const { return m_active; };
+
+    // Consumes the characters received so far without blocking.
+    Result receive();
+
+    // Only changes the settings if the complete blob is valid.
+    bool apply(SettingsStore &settings_store) const;
+};
+
+} // namespace Doncon::Utils
+
+#endif // _UTILS_SETTINGSIMPORT_H_
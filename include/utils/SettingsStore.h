@@ -1,34 +1,127 @@
 #ifndef _UTILS_SETTINGSSTORE_H_
 #define _UTILS_SETTINGSSTORE_H_
 
+#include "peripherals/Controller.h"
 #include "peripherals/Drum.h"
 #include "usb/device_driver.h"
 
 #include "hardware/flash.h"
 
+#include <array>
+
 namespace Doncon::Utils {
 
 class SettingsStore {
+  public:
+    // Each profile is a complete set of settings, names are configured in GlobalConfiguration.h.
+    const static uint8_t profile_count = 4;
+
+    struct CommitStats {
+        uint32_t commits;
+        uint32_t erases;
+        uint32_t programs;
+        uint32_t last_erase_us; // Time spent with interrupts disabled
+        uint32_t last_program_us;
+        uint32_t max_blocking_us;
+        uint32_t over_budget; // Steps which blocked longer than the configured budget
+
+        // Current position within the journal
+        uint32_t sequence;
+        uint8_t sector;
+        uint8_t next_page;
+    };
+
   private:
-    const static uint32_t m_flash_size = FLASH_SECTOR_SIZE;
-    const static uint32_t m_flash_offset = PICO_FLASH_SIZE_BYTES - m_flash_size;
-    const static uint32_t m_store_size = FLASH_PAGE_SIZE;
-    const static uint32_t m_store_pages = m_flash_size / m_store_size;
-    const static uint8_t m_magic_byte = 0x39;
-
-    struct __attribute((packed, aligned(1))) Storecache {
-        uint8_t in_use;
+    const static uint32_t m_page_size = FLASH_PAGE_SIZE;
+    const static uint8_t m_pages_per_sector = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+    const static uint8_t m_magic_byte = 0x5F;
+    const static uint8_t m_single_page_magic_byte = 0x5E; // Record format before the journal
+    const static uint8_t m_legacy_magic_byte = 0x39;      // Packed struct used before the record format
+    const static uint8_t m_blob_magic_byte = 0x5D;        // Exported settings, never written to flash
+    const static uint8_t m_schema_version = 3;            // Version 1 is the legacy struct, 3 added profiles
+
+    struct Storecache {
         usb_mode_t usb_mode;
         Peripherals::Drum::Config::Thresholds trigger_thresholds;
         uint8_t led_brightness;
         bool led_enable_player_color;
         uint16_t debounce_delay;
+        Peripherals::Buttons::SocdMode socd_mode;
+        usb_timing_t usb_timing[USB_MODE_COUNT]; // Zeroed entries use the defaults
+    };
+
+    struct Settings {
+        uint8_t active_profile;
+        std::array<Storecache, profile_count> profiles;
+    };
+
+    // Settings are kept in a journal spanning several flash sectors. Each sector starts with a
+    // snapshot of all settings, followed by pages only containing the records which changed.
+    enum class PageType : uint8_t {
+        Snapshot,
+        Delta,
+    };
+
+    // Each journal page starts with this header, followed by tag-length-value records.
+    struct __attribute((packed, aligned(1))) PageHeader {
+        uint8_t magic;
+        uint8_t schema_version;
+        uint16_t length;   // Of the records following the header
+        uint32_t crc32;    // Over the remaining header fields and the records
+        uint32_t sequence; // Incremented with every page written
+        PageType type;
+    };
+
+    // Tags must never be reused for a different meaning. Unknown tags are skipped when reading,
+    // missing ones keep their default value.
+    enum class Tag : uint8_t {
+        UsbMode = 0x01,
+        TriggerThresholds = 0x02,
+        LedBrightness = 0x03,
+        LedEnablePlayerColor = 0x04,
+        DebounceDelay = 0x05,
+        SocdMode = 0x06,
+        UsbTiming = 0x07, // Indexed by usb_mode_t, shorter values leave the remaining modes at their defaults
+
+        // Records following this one belong to the given profile, the ones before to the first profile.
+        Profile = 0x08,
+        ActiveProfile = 0x09,
+    };
 
-        uint8_t _padding[m_store_size - sizeof(uint8_t) - sizeof(usb_mode_t) -
-                         sizeof(Peripherals::Drum::Config::Thresholds) - sizeof(uint8_t) - sizeof(bool) -
-                         sizeof(uint16_t)];
+    // Encoded size of all records of a profile, including the Profile record preceding them.
+    const static size_t m_profile_tag_count = 7;
+    const static size_t m_profile_records_size = 3 + m_profile_tag_count * 2 + 4 * sizeof(uint8_t) + sizeof(uint16_t) +
+                                                 sizeof(Peripherals::Drum::Config::Thresholds) +
+                                                 sizeof(usb_timing_t[USB_MODE_COUNT]);
+    static_assert(sizeof(PageHeader) + 3 + profile_count * m_profile_records_size <= m_page_size);
+
+    // Header of exported settings, followed by the records of all profiles like a snapshot page.
+    struct __attribute((packed, aligned(1))) BlobHeader {
+        uint8_t magic;
+        uint8_t schema_version;
+        uint16_t length; // Of the records following the header
+        uint32_t crc32;  // Over the records only
+    };
+
+  public:
+    const static size_t blob_max_size = sizeof(BlobHeader) + 3 + profile_count * m_profile_records_size;
+
+  private:
+
+    using Page = std::array<uint8_t, m_page_size>;
+
+    // Flash operations of a pending commit, executed one at a time by update().
+    struct Commit {
+        uint8_t erase_sector;
+        uint8_t erase_count; // Sectors still to be erased, starting at erase_sector
+        bool program;
+        uint8_t sector;
+        uint8_t page;
+        PageType type;
+        uint32_t sequence;
+        Settings cache; // Settings once the page has been written
+        Page data;
     };
-    static_assert(sizeof(Storecache) == m_store_size);
 
     enum class RebootType {
         None,
@@ -36,17 +129,50 @@ class SettingsStore {
         Bootsel,
     };
 
-    Storecache m_store_cache;
+    Settings m_settings;
+    Storecache *m_store_cache; // Active profile within m_settings
     bool m_dirty;
 
+    Settings m_persisted; // Settings as found in flash, base for delta pages
+    bool m_journal_valid; // False if no snapshot has been written yet
+    uint8_t m_sector;
+    uint8_t m_next_page;
+    uint32_t m_sequence;
+
+    Commit m_commit;
+    uint32_t m_last_input_us;
+    uint32_t m_last_step_us;
+    CommitStats m_commit_stats;
+
     RebootType m_scheduled_reboot;
 
   private:
-    Storecache read();
+    static Storecache getDefaults();
+    static Settings getDefaultSettings();
+
+    static size_t encodeRecords(uint8_t *out, const Settings &settings, const Settings *base);
+    static size_t encodeProfileRecords(uint8_t *out, const Storecache &cache, const Storecache *base);
+    // Returns false if a record is truncated or holds an invalid value, all valid records are applied anyway.
+    static bool decodeRecords(const uint8_t *records, const size_t length, Settings &settings);
+    // Returns false if the page is not a valid journal page.
+    static bool readHeader(const uint8_t *page, PageHeader &header);
+
+    bool readJournal();
+    bool readUnjournaled();
+
+    void encodeCommit();
+
+    // Runs a flash operation with the other core locked out and interrupts disabled, returns the time it took.
+    template <typename T> uint32_t runBlocking(T operation);
+    void reboot();
 
   public:
     SettingsStore();
 
+    // Switches all settings at once, only the profile index needs to be written.
+    void setActiveProfile(const uint8_t profile);
+    uint8_t getActiveProfile();
+
     void setUsbMode(const usb_mode_t mode);
     usb_mode_t getUsbMode();
 
@@ -62,10 +188,29 @@ class SettingsStore {
     void setDebounceDelay(const uint16_t delay);
     uint16_t getDebounceDelay();
 
+    void setSocdMode(const Peripherals::Buttons::SocdMode mode);
+    Peripherals::Buttons::SocdMode getSocdMode();
+
+    void setUsbTiming(const usb_mode_t mode, const usb_timing_t &timing);
+    usb_timing_t getUsbTiming(const usb_mode_t mode);
+
     void scheduleReboot(const bool bootsel = false);
 
+    // Writes all settings of all profiles to out, which needs to hold blob_max_size bytes. Returns the length.
+    size_t exportSettings(uint8_t *out) const;
+    // Replaces all settings with the ones of an exported blob. Nothing is changed if the blob is invalid,
+    // the new settings are written in a single page by the next store().
+    bool importSettings(const uint8_t *blob, const size_t length);
+
+    // Queues the current settings to be written, the write itself happens in update().
     void store();
     void reset();
+
+    // Needs to be called regularly, executes one pending flash operation once inputs have been idle.
+    void update(const bool inputs_active);
+    bool commitPending() const { return m_commit.erase_count != 0 || m_commit.program; };
+
+    CommitStats getCommitStats() const;
 };
 } // namespace Doncon::Utils
 
@@ -0,0 +1,91 @@
+#ifndef _UTILS_TRACE_H_
+#define _UTILS_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tracepoints are only compiled in if DONCON_TRACE is enabled, e.g. via `cmake -DDONCON_TRACE=ON`.
+#ifndef DONCON_TRACE
+#define DONCON_TRACE 0
+#endif
+
+// Entries per core, needs to be a power of two.
+#ifndef DONCON_TRACE_BUFFER_SIZE
+#define DONCON_TRACE_BUFFER_SIZE (1024)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    TRACE_CORE0_LOOP,
+    TRACE_SCHEDULER_TASK, // Arg is the task index
+    TRACE_DISPLAY_UPDATE,
+    TRACE_BUTTONS_UPDATE,
+    TRACE_SETTINGS_STORE,
+    TRACE_USB_SEND, // Arg is the report size
+    TRACE_EVENT_COUNT,
+} trace_event_t;
+
+// Phases are the ones used by the Chrome trace event format.
+typedef enum {
+    TRACE_PHASE_BEGIN = 'B',
+    TRACE_PHASE_END = 'E',
+    TRACE_PHASE_INSTANT = 'i',
+} trace_phase_t;
+
+typedef struct {
+    uint32_t timestamp_us;
+    uint8_t event_id;
+    uint8_t phase;
+    uint16_t arg;
+} trace_entry_t;
+
+extern const char *const trace_event_names[TRACE_EVENT_COUNT];
+
+// Lock-free, each core only writes to its own buffer. Must not be used from interrupt handlers.
+void trace_record(trace_event_t event, trace_phase_t phase, uint16_t arg);
+
+void trace_set_enabled(bool enabled);
+// Copies up to max_entries of the most recent entries of a core, oldest first, returns the number of entries copied.
+uint32_t trace_read(uint8_t core, trace_entry_t *entries, uint32_t max_entries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if DONCON_TRACE
+#define TRACE_BEGIN(event, arg) trace_record((event), TRACE_PHASE_BEGIN, (arg))
+#define TRACE_END(event, arg) trace_record((event), TRACE_PHASE_END, (arg))
+#define TRACE_INSTANT(event, arg) trace_record((event), TRACE_PHASE_INSTANT, (arg))
+#else
+#define TRACE_BEGIN(event, arg) ((void)0)
+#define TRACE_END(event, arg) ((void)0)
+#define TRACE_INSTANT(event, arg) ((void)0)
+#endif
+
+#ifdef __cplusplus
+namespace Doncon::Utils {
+
+// Records a begin and end tracepoint for the enclosing scope.
+class TraceScope {
+  private:
+    [[maybe_unused]] trace_event_t m_event;
+    [[maybe_unused]] uint16_t m_arg;
+
+  public:
+    TraceScope(trace_event_t event, uint16_t arg) : m_event(event), m_arg(arg) { TRACE_BEGIN(m_event, m_arg); }
+    ~TraceScope() { TRACE_END(m_event, m_arg); }
+};
+
+} // namespace Doncon::Utils
+
+#if DONCON_TRACE
+#define TRACE_SCOPE(event, arg) Doncon::Utils::TraceScope trace_scope((event), (arg))
+#else
+#define TRACE_SCOPE(event, arg) ((void)0)
+#endif
+#endif
+
+#endif // _UTILS_TRACE_H_
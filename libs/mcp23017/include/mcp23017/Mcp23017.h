@@ -34,6 +34,17 @@ class Mcp23017 {
     enum class Port { A, B };
     enum class Direction { IN, OUT };
 
+    // IOCON bits, INTA and INTB are internally connected if MIRROR is set.
+    enum Iocon : uint8_t {
+        INTPOL = 1 << 1,
+        ODR = 1 << 2,
+        HAEN = 1 << 3,
+        DISSLW = 1 << 4,
+        SEQOP = 1 << 5,
+        MIRROR = 1 << 6,
+        BANK = 1 << 7,
+    };
+
   private:
     i2c_inst *m_i2c;
     uint8_t m_address;
@@ -56,6 +67,13 @@ class Mcp23017 {
     void setReversePolarity(uint8_t pin, bool reverse);
     void setReversePolarity(uint8_t pin, Port port, bool reverse);
 
+    void setInterruptConfig(uint8_t iocon_flags);
+    void setInterruptEnable(uint16_t enable_mask);
+    void setInterruptCompare(uint16_t compare_mask, uint16_t default_value);
+
+    uint16_t readInterruptFlags();
+    uint16_t readInterruptCapture();
+
     uint16_t read();
     uint8_t read(Port port);
     bool read(uint8_t pin);
@@ -147,6 +147,23 @@ void Mcp23017::setReversePolarity(uint8_t pin, Port port, bool reverse) {
     }
 }
 
+void Mcp23017::setInterruptConfig(uint8_t iocon_flags) {
+    // Only the interrupt related bits may be changed, the driver relies on BANK = 0 and sequential operation.
+    writeRegister8(Register::IOCON, iocon_flags & (Iocon::INTPOL | Iocon::ODR | Iocon::MIRROR));
+}
+
+void Mcp23017::setInterruptEnable(uint16_t enable_mask) { writeRegister16(Register::GPINTENA, enable_mask); }
+
+void Mcp23017::setInterruptCompare(uint16_t compare_mask, uint16_t default_value) {
+    // Pins not set in compare_mask trigger on any change compared to their previous value.
+    writeRegister16(Register::DEFVALA, default_value);
+    writeRegister16(Register::INTCONA, compare_mask);
+}
+
+uint16_t Mcp23017::readInterruptFlags() { return readRegister16(Register::INTFA); }
+
+uint16_t Mcp23017::readInterruptCapture() { return readRegister16(Register::INTCAPA); }
+
 uint16_t Mcp23017::read() { return readRegister16(Register::GPIOA); }
 
 uint8_t Mcp23017::read(Port port) {
@@ -9,6 +9,14 @@ class Mcp3204Dma {
   public:
     static constexpr size_t channel_count = 4;
 
+    struct Stats {
+        std::array<uint32_t, channel_count> conversions;
+        uint32_t read_irqs;
+        uint32_t alarm_irqs;
+        uint32_t irq_busy_us;  // Time spent in both interrupt handlers
+        uint32_t max_cycle_us; // Longest time for reading all channels once since the last call
+    };
+
   public:
     Mcp3204Dma(spi_inst *spi, uint8_t cs_pin);
     ~Mcp3204Dma();
@@ -17,6 +25,11 @@ class Mcp3204Dma {
     void stop();
 
     std::array<uint16_t, channel_count> take_maximums();
+    // Additionally returns the time in microseconds since boot at which each maximum was sampled.
+    std::array<uint16_t, channel_count> take_maximums(std::array<uint32_t, channel_count> &sample_times_us);
+
+    // Counters are free running and wrap around.
+    Stats take_stats();
 };
 
 #endif // _MCP3204_MCP3204DMA_H_
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "hardware/dma.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
 
 namespace {
@@ -24,12 +25,23 @@ volatile uint8_t tx_buffer[transfer_length] = {
 
 volatile uint8_t current_channel = 0;
 volatile uint16_t current_max_readings[Mcp3204Dma::channel_count] = {};
-
-// Alarm handler to instantly (re)start DMA reading of the next channel.
-int64_t start_dma_read(alarm_id_t id, void *user_data) {
+volatile uint32_t current_max_times_us[Mcp3204Dma::channel_count] = {};
+
+volatile uint32_t conversions[Mcp3204Dma::channel_count] = {};
+volatile uint32_t read_irqs = 0;
+volatile uint32_t alarm_irqs = 0;
+volatile uint32_t irq_busy_us = 0;
+volatile uint32_t cycle_start_us = 0;
+volatile uint32_t max_cycle_us = 0;
+
+// Alarm handler to instantly (re)start DMA reading of the next channel. All interrupt handlers run from
+// RAM to avoid stalling on XIP cache misses.
+int64_t __not_in_flash_func(start_dma_read)(alarm_id_t id, void *user_data) {
     (void)user_data;
     (void)id;
 
+    const uint32_t start_us = time_us_32();
+
     // Reset addresses
     dma_channel_set_read_addr(tx_channel, tx_buffer, false);
     dma_channel_set_write_addr(rx_channel, rx_buffer, false);
@@ -38,34 +50,52 @@ int64_t start_dma_read(alarm_id_t id, void *user_data) {
     gpio_put(cs_pin, false);
     dma_start_channel_mask((1 << tx_channel) | (1 << rx_channel));
 
+    alarm_irqs = alarm_irqs + 1;
+    irq_busy_us = irq_busy_us + (time_us_32() - start_us);
+
     // Do not reschedule alarm
     return 0;
 }
 
 // Pull up CS pin and start DMA reading after a 1us delay, this is because MCP3204
 // needs to be the CS pin high for at least 500ns.
-void trigger_dma_read() {
+void __not_in_flash_func(trigger_dma_read)() {
     gpio_put(cs_pin, true);
 
     add_alarm_in_us(2, start_dma_read, nullptr, true);
 }
 
-void read_handler() {
+void __not_in_flash_func(read_handler)() {
+    const uint32_t start_us = time_us_32();
+
     // The 12 result bits are at the end of the ADC's output.
     const uint16_t value = (static_cast<uint16_t>(rx_buffer[1] & 0x0F) << 8) | rx_buffer[2];
 
     // We only care for the maximum value since the last read
     if (value > current_max_readings[current_channel]) {
         current_max_readings[current_channel] = value;
+        current_max_times_us[current_channel] = start_us;
     }
+    conversions[current_channel] = conversions[current_channel] + 1;
 
     // Advance to the next channel
     current_channel = (current_channel + 1) % Mcp3204Dma::channel_count;
     tx_buffer[1] = static_cast<uint8_t>(current_channel << 6);
 
+    if (current_channel == 0) {
+        const uint32_t cycle_us = start_us - cycle_start_us;
+        if (cycle_us > max_cycle_us) {
+            max_cycle_us = cycle_us;
+        }
+        cycle_start_us = start_us;
+    }
+
     dma_channel_acknowledge_irq0(rx_channel);
 
     trigger_dma_read();
+
+    read_irqs = read_irqs + 1;
+    irq_busy_us = irq_busy_us + (time_us_32() - start_us);
 }
 
 } // namespace
@@ -108,6 +138,9 @@ void Mcp3204Dma::run() {
     dma_channel_set_irq0_enabled(rx_channel, true);
     irq_set_enabled(DMA_IRQ_0, true);
 
+    // Let the first round start now, not at boot
+    cycle_start_us = time_us_32();
+
     trigger_dma_read();
 }
 
@@ -119,7 +152,7 @@ void Mcp3204Dma::stop() {
     dma_channel_wait_for_finish_blocking(tx_channel);
 }
 
-std::array<uint16_t, Mcp3204Dma::channel_count> Mcp3204Dma::take_maximums() {
+std::array<uint16_t, Mcp3204Dma::channel_count> __not_in_flash_func(Mcp3204Dma::take_maximums)() {
     // TODO: theoretically we should need to pause conversion for reading the values,
     //       but so far this does not seem to pose any issue.
 
@@ -129,5 +162,30 @@ std::array<uint16_t, Mcp3204Dma::channel_count> Mcp3204Dma::take_maximums() {
     // Reset values to zero
     std::fill(std::begin(current_max_readings), std::end(current_max_readings), 0);
 
+    return result;
+}
+
+std::array<uint16_t, Mcp3204Dma::channel_count>
+__not_in_flash_func(Mcp3204Dma::take_maximums)(std::array<uint32_t, channel_count> &sample_times_us) {
+    std::copy(std::begin(current_max_times_us), std::end(current_max_times_us), std::begin(sample_times_us));
+
+    return take_maximums();
+}
+
+Mcp3204Dma::Stats Mcp3204Dma::take_stats() {
+    // Read and reset without the read handler interleaving, which would lose a new maximum
+    const auto irq_state = save_and_disable_interrupts();
+
+    Stats result;
+    std::copy(std::begin(conversions), std::end(conversions), std::begin(result.conversions));
+    result.read_irqs = read_irqs;
+    result.alarm_irqs = alarm_irqs;
+    result.irq_busy_us = irq_busy_us;
+    result.max_cycle_us = max_cycle_us;
+
+    max_cycle_us = 0;
+
+    restore_interrupts(irq_state);
+
     return result;
 }
\ No newline at end of file
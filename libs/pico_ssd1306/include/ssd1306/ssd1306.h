@@ -141,6 +141,15 @@ void ssd1306_invert(ssd1306_t *p, uint8_t inv);
 */
 void ssd1306_show(ssd1306_t *p);
 
+/**
+    @brief display a single page (8 pixel rows) of the buffer, allows splitting up a transfer
+
+    @param[in] p : instance of display
+    @param[in] page : page to display
+
+*/
+void ssd1306_show_page(ssd1306_t *p, uint8_t page);
+
 /**
     @brief clear display buffer
 
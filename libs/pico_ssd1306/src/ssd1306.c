@@ -279,4 +279,27 @@ void ssd1306_show(ssd1306_t *p) {
     *(p->buffer - 1) = 0x40;
 
     fancy_write(p->i2c_i, p->address, p->buffer - 1, p->bufsize + 1, "ssd1306_show");
+}
+
+void ssd1306_show_page(ssd1306_t *p, uint8_t page) {
+    if (page >= p->pages)
+        return;
+
+    uint8_t payload[] = {SET_COL_ADDR, 0, p->width - 1, SET_PAGE_ADDR, page, page};
+    if (p->width == 64) {
+        payload[1] += 32;
+        payload[2] += 32;
+    }
+
+    for (size_t i = 0; i < sizeof(payload); ++i)
+        ssd1306_write(p, payload[i]);
+
+    // Borrow the byte in front of the page for the control byte, it's the last byte of the previous page.
+    uint8_t *data = p->buffer + (page * p->width) - 1;
+    const uint8_t backup = *data;
+    *data = 0x40;
+
+    fancy_write(p->i2c_i, p->address, data, p->width + 1, "ssd1306_show_page");
+
+    *data = backup;
 }
\ No newline at end of file
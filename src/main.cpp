@@ -3,8 +3,16 @@
 #include "peripherals/Drum.h"
 #include "peripherals/StatusLed.h"
 #include "usb/device_driver.h"
+#include "utils/ConfigProtocol.h"
+#include "utils/DebugConsole.h"
+#include "utils/HeapTracker.h"
+#include "utils/LatencyTracker.h"
+#include "utils/LoopProfiler.h"
+#include "utils/MemoryMonitor.h"
 #include "utils/Menu.h"
+#include "utils/Scheduler.h"
 #include "utils/SettingsStore.h"
+#include "utils/Trace.h"
 
 #include "GlobalConfiguration.h"
 
@@ -12,7 +20,8 @@
 #include "pico/stdlib.h"
 #include "pico/util/queue.h"
 
-#include <stdio.h>
+#include <algorithm>
+#include <array>
 
 using namespace Doncon;
 
@@ -20,12 +29,17 @@ queue_t control_queue;
 queue_t menu_display_queue;
 queue_t drum_input_queue;
 queue_t controller_input_queue;
+queue_t scheduler_report_queue;
+queue_t latency_report_queue;
+queue_t profile_display_queue;
+queue_t profile_report_queue;
 
 enum class ControlCommand {
     SetUsbMode,
     SetPlayerLed,
     SetLedBrightness,
     SetLedEnablePlayerColor,
+    SetSocdMode,
     EnterMenu,
     ExitMenu,
 };
@@ -37,10 +51,38 @@ struct ControlMessage {
         usb_player_led_t player_led;
         uint8_t led_brightness;
         bool led_enable_player_color;
+        Peripherals::Buttons::SocdMode socd_mode;
     } data;
 };
 
+// Holding Select and one of the face buttons while plugging in switches to the respective profile.
+static void selectBootProfile(Utils::SettingsStore &settings_store) {
+    static const uint32_t boot_window_ms = 100;
+
+    const auto deadline = make_timeout_time_ms(boot_window_ms);
+    Utils::InputState::Controller controller;
+
+    while (!time_reached(deadline)) {
+        if (!queue_try_remove(&controller_input_queue, &controller) || !controller.buttons.select) {
+            continue;
+        }
+
+        const std::array<bool, 4> combos = {controller.buttons.north, controller.buttons.east,
+                                            controller.buttons.south, controller.buttons.west};
+        for (uint8_t profile = 0; profile < std::min<size_t>(combos.size(), Utils::SettingsStore::profile_count);
+             ++profile) {
+            if (combos[profile]) {
+                settings_store.setActiveProfile(profile);
+                settings_store.store();
+                return;
+            }
+        }
+    }
+}
+
 void core1_task() {
+    Utils::MemoryMonitor::paintStack();
+
     multicore_lockout_victim_init();
 
     // Init i2c port here because Controller and Display share it and
@@ -59,13 +101,16 @@ void core1_task() {
     Utils::Menu::State menu_display_msg;
     ControlMessage control_msg;
 
-    while (true) {
-        buttons.updateInputState(input_state);
+    Utils::Scheduler scheduler;
+    Utils::LoopProfiler loop_profiler;
 
+    scheduler.addTask("buttons", 500, [&]() {
+        buttons.updateInputState(input_state);
         queue_try_add(&controller_input_queue, &input_state.controller);
-        queue_try_remove(&drum_input_queue, &input_state.drum);
+    });
 
-        if (queue_try_remove(&control_queue, &control_msg)) {
+    scheduler.addTask("control", 500, [&]() {
+        while (queue_try_remove(&control_queue, &control_msg)) {
             switch (control_msg.command) {
             case ControlCommand::SetUsbMode:
                 display.setUsbMode(control_msg.data.usb_mode);
@@ -86,6 +131,9 @@ void core1_task() {
             case ControlCommand::SetLedEnablePlayerColor:
                 led.setEnablePlayerColor(control_msg.data.led_enable_player_color);
                 break;
+            case ControlCommand::SetSocdMode:
+                buttons.setSocdMode(control_msg.data.socd_mode);
+                break;
             case ControlCommand::EnterMenu:
                 display.showMenu();
                 break;
@@ -97,32 +145,78 @@ void core1_task() {
         if (queue_try_remove(&menu_display_queue, &menu_display_msg)) {
             display.setMenuState(menu_display_msg);
         }
+        display.receiveLatencyReport(&latency_report_queue);
+        display.receiveLoopReport(0, &profile_display_queue);
+    });
 
-        led.setInputState(input_state);
-        display.setInputState(input_state);
+    scheduler.addTask("led", 1000, [&]() {
+        queue_try_remove(&drum_input_queue, &input_state.drum);
+        display.trackDrum(input_state.drum);
 
+        led.setInputState(input_state);
         led.update();
+    });
+
+    // Rendering is cheap, the i2c transfer is split up into single pages to keep button latency low.
+    scheduler.addTask("display", 33333, [&]() {
+        Utils::HeapTracker::setRegion(Utils::HeapTracker::Region::Display);
+
+        display.setInputState(input_state);
+        display.setLoopReport(1, loop_profiler.getReport());
         display.update();
+
+        Utils::HeapTracker::setRegion(Utils::HeapTracker::Region::Core1Io);
+    });
+    scheduler.addTask("display_tx", 2000, [&]() { display.transfer(); });
+
+    scheduler.addTask("stats", 1000000, [&]() {
+        const auto report = scheduler.getReport();
+        queue_try_add(&scheduler_report_queue, &report);
+
+        const auto loop_report = loop_profiler.getReport();
+        queue_try_add(&profile_report_queue, &loop_report);
+    });
+
+    Utils::HeapTracker::setRegion(Utils::HeapTracker::Region::Core1Io);
+
+    while (true) {
+        loop_profiler.tick();
+        scheduler.update();
     }
 }
 
 int main() {
+    Utils::MemoryMonitor::paintStack();
+
     queue_init(&control_queue, sizeof(ControlMessage), 1);
     queue_init(&menu_display_queue, sizeof(Utils::Menu::State), 1);
     queue_init(&drum_input_queue, sizeof(Utils::InputState::Drum), 1);
     queue_init(&controller_input_queue, sizeof(Utils::InputState::Controller), 1);
+    queue_init(&scheduler_report_queue, sizeof(Utils::Scheduler::Report), 1);
+    queue_init(&latency_report_queue, sizeof(Utils::LatencyTracker::Report), 1);
+    queue_init(&profile_display_queue, sizeof(Utils::LoopProfiler::Report), 1);
+    queue_init(&profile_report_queue, sizeof(Utils::LoopProfiler::Report), 1);
 
     Utils::InputState input_state;
+    Utils::LatencyTracker latency_tracker;
+    Utils::LoopProfiler loop_profiler;
 
     auto settings_store = std::make_shared<Utils::SettingsStore>();
     Utils::Menu menu(settings_store);
-
-    const auto mode = settings_store->getUsbMode();
+    Utils::ConfigProtocol config_protocol(settings_store);
 
     Peripherals::Drum drum(Config::Default::drum_config);
 
     multicore_launch_core1(core1_task);
 
+    // The USB mode depends on the profile, so it needs to be selected before USB is set up.
+    selectBootProfile(*settings_store);
+    auto mode = settings_store->getUsbMode();
+    auto interval_ms = settings_store->getUsbTiming(mode).interval_ms;
+
+    usbd_driver_set_sof_lead_time(Config::Default::usb_sof_lead_time_us);
+    usbd_driver_set_timing(settings_store->getUsbTiming(mode));
+    usbd_driver_set_config_interface(Config::Default::usb_config_interface[mode]);
     usbd_driver_init(mode);
     usbd_driver_set_player_led_cb([](usb_player_led_t player_led) {
         const auto ctrl_message = ControlMessage{ControlCommand::SetPlayerLed, {.player_led = player_led}};
@@ -143,25 +237,66 @@ int main() {
                         {.led_enable_player_color = settings_store->getLedEnablePlayerColor()}};
         queue_add_blocking(&control_queue, &ctrl_message);
 
+        ctrl_message = {ControlCommand::SetSocdMode, {.socd_mode = settings_store->getSocdMode()}};
+        queue_add_blocking(&control_queue, &ctrl_message);
+
+        usbd_driver_set_timing(settings_store->getUsbTiming(mode));
+
         drum.setDebounceDelay(settings_store->getDebounceDelay());
         drum.setThresholds(settings_store->getTriggerThresholds());
     };
 
     readSettings();
 
+    // Mode and polling interval are part of the descriptors, so the host needs to enumerate again.
+    const auto applyUsbMode = [&]() {
+        const auto timing = settings_store->getUsbTiming(settings_store->getUsbMode());
+
+        if (settings_store->getUsbMode() != mode || timing.interval_ms != interval_ms) {
+            mode = settings_store->getUsbMode();
+            interval_ms = timing.interval_ms;
+
+            usbd_driver_set_timing(timing);
+            usbd_driver_set_config_interface(Config::Default::usb_config_interface[mode]);
+            usbd_driver_switch_mode(mode);
+            input_state.resetReports();
+        }
+    };
+
+    Utils::DebugConsole debug_console(settings_store, drum, input_state, latency_tracker, loop_profiler,
+                                      {&scheduler_report_queue, &profile_report_queue});
+
+    Utils::HeapTracker::markStartupComplete();
+
     while (true) {
+        TRACE_BEGIN(TRACE_CORE0_LOOP, 0);
+        loop_profiler.tick();
+
+        Utils::HeapTracker::setRegion(Utils::HeapTracker::Region::Drum);
         drum.updateInputState(input_state);
         queue_try_remove(&controller_input_queue, &input_state.controller);
 
         const auto drum_message = input_state.drum;
 
+        Utils::HeapTracker::setRegion(Utils::HeapTracker::Region::Menu);
+        settings_store->update(input_state.anyPressed());
+
         if (menu.active()) {
             menu.update(input_state.controller);
             if (menu.active()) {
                 const auto display_msg = menu.getState();
                 queue_add_blocking(&menu_display_queue, &display_msg);
+
+                if (display_msg.page == Utils::Menu::Page::Latency) {
+                    const auto latency_report = latency_tracker.getReport();
+                    queue_try_add(&latency_report_queue, &latency_report);
+                } else if (display_msg.page == Utils::Menu::Page::LoopProfile) {
+                    const auto loop_report = loop_profiler.getReport();
+                    queue_try_add(&profile_display_queue, &loop_report);
+                }
             } else {
                 settings_store->store();
+                applyUsbMode();
 
                 ControlMessage ctrl_message = {ControlCommand::ExitMenu, {}};
                 queue_add_blocking(&control_queue, &ctrl_message);
@@ -177,10 +312,35 @@ int main() {
             queue_add_blocking(&control_queue, &ctrl_message);
         }
 
+        // The debug report is a formatted string and therefore allowed to allocate.
+        Utils::HeapTracker::setRegion(mode == USB_MODE_DEBUG ? Utils::HeapTracker::Region::Debug
+                                                             : Utils::HeapTracker::Region::Usb);
         usbd_driver_send_report(input_state.getReport(mode));
         usbd_driver_task();
+        latency_tracker.update(input_state);
+
+        config_protocol.stream(input_state.drum);
+        if (config_protocol.takeChanged()) {
+            readSettings();
+        }
+        if (config_protocol.takeCommitRequest()) {
+            settings_store->store();
+            applyUsbMode();
+        }
+
+        if (mode == USB_MODE_DEBUG) {
+            Utils::HeapTracker::setRegion(Utils::HeapTracker::Region::Debug);
+            debug_console.update();
+            if (debug_console.takeImported()) {
+                settings_store->store();
+                applyUsbMode();
+                readSettings();
+            }
+        }
 
         queue_try_add(&drum_input_queue, &drum_message);
+
+        TRACE_END(TRACE_CORE0_LOOP, 0);
     }
 
     return 0;
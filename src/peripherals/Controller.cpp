@@ -1,96 +1,282 @@
 #include "peripherals/Controller.h"
 
+#include "utils/Trace.h"
+
+#include "hardware/gpio.h"
 #include "pico/time.h"
 
 namespace Doncon::Peripherals {
 
-Buttons::Button::Button(uint8_t pin) : gpio_pin(pin), gpio_mask(1 << pin), last_change(0), active(false) {}
+namespace {
 
-void Buttons::Button::setState(bool state, uint8_t debounce_delay) {
-    if (active == state) {
-        return;
-    }
+volatile uint mcp23017_interrupt_pin = 0;
+volatile bool mcp23017_interrupt_pending = true;
 
-    // Immediately change the input state, but only allow a change every debounce_delay milliseconds.
-    uint32_t now = to_ms_since_boot(get_absolute_time());
-    if (last_change + debounce_delay <= now) {
-        active = state;
-        last_change = now;
+void mcp23017_interrupt_handler(uint gpio, uint32_t event_mask) {
+    (void)event_mask;
+
+    if (gpio == mcp23017_interrupt_pin) {
+        mcp23017_interrupt_pending = true;
     }
 }
 
-void Buttons::socdClean(Utils::InputState &input_state) {
+// Maps previous input | current input << 2 | previous output << 4 of an axis to its output.
+using SocdTable = std::array<uint8_t, 64>;
 
-    // Last input has priority
-    if (input_state.controller.dpad.up && input_state.controller.dpad.down) {
-        if (m_socd_state.lastVertical == Id::DOWN) {
-            input_state.controller.dpad.down = false;
-        } else if (m_socd_state.lastVertical == Id::UP) {
-            input_state.controller.dpad.up = false;
+constexpr uint8_t socd_resolve(const Buttons::SocdMode mode, const bool is_vertical, const uint8_t previous_input,
+                               const uint8_t input, const uint8_t previous_output) {
+    if (input != 0b11) {
+        return input;
+    }
+
+    switch (mode) {
+    case Buttons::SocdMode::LastWins:
+        if (previous_input == 0b01 || previous_input == 0b10) {
+            return previous_input ^ 0b11;
         }
-    } else if (input_state.controller.dpad.up) {
-        m_socd_state.lastVertical = Id::UP;
+        break;
+    case Buttons::SocdMode::FirstWins:
+        if (previous_input == 0b01 || previous_input == 0b10) {
+            return previous_input;
+        }
+        break;
+    case Buttons::SocdMode::Neutral:
+        return 0b00;
+    case Buttons::SocdMode::UpPriority:
+        return is_vertical ? 0b01 : 0b00;
+    }
+
+    // Both still held or pressed at the same time, keep the previous decision or fall back to up/left.
+    if (previous_output == 0b01 || previous_output == 0b10) {
+        return previous_output;
+    }
+    return 0b01;
+}
+
+constexpr SocdTable make_socd_table(const Buttons::SocdMode mode, const bool is_vertical) {
+    SocdTable table{};
+    for (size_t idx = 0; idx < table.size(); ++idx) {
+        table[idx] = socd_resolve(mode, is_vertical, idx & 0b11, (idx >> 2) & 0b11, (idx >> 4) & 0b11);
+    }
+    return table;
+}
+
+// Indexed by SocdMode, then vertical/horizontal axis.
+constexpr std::array<std::array<SocdTable, 2>, 4> socd_tables = {{
+    {make_socd_table(Buttons::SocdMode::LastWins, true), make_socd_table(Buttons::SocdMode::LastWins, false)},
+    {make_socd_table(Buttons::SocdMode::FirstWins, true), make_socd_table(Buttons::SocdMode::FirstWins, false)},
+    {make_socd_table(Buttons::SocdMode::Neutral, true), make_socd_table(Buttons::SocdMode::Neutral, false)},
+    {make_socd_table(Buttons::SocdMode::UpPriority, true), make_socd_table(Buttons::SocdMode::UpPriority, false)},
+}};
+
+} // namespace
+
+Buttons::Debouncer::Debouncer() : m_state(0), m_lockout{0, 0, 0}, m_last_tick_us(0) {}
+
+void Buttons::Debouncer::tick() {
+    // Decrement all running counters, a counter is running if any of its bits is set.
+    const uint32_t running = m_lockout[0] | m_lockout[1] | m_lockout[2];
+    const uint32_t borrow0 = running & ~m_lockout[0];
+    const uint32_t borrow1 = borrow0 & ~m_lockout[1];
+
+    m_lockout[0] ^= running;
+    m_lockout[1] ^= borrow0;
+    m_lockout[2] ^= borrow1;
+}
+
+uint32_t Buttons::Debouncer::update(const uint32_t raw, const uint32_t now_us, const uint8_t debounce_delay_ms) {
+    const uint32_t tick_us = (static_cast<uint32_t>(debounce_delay_ms) * 1000) / (m_lockout_ticks - 1);
+
+    if (tick_us == 0) {
+        m_lockout[0] = m_lockout[1] = m_lockout[2] = 0;
+        m_last_tick_us = now_us;
     } else {
-        m_socd_state.lastVertical = Id::DOWN;
+        uint8_t ticks = 0;
+        while ((now_us - m_last_tick_us) >= tick_us && ticks < m_lockout_ticks) {
+            tick();
+            m_last_tick_us += tick_us;
+            ticks++;
+        }
+
+        // All counters expired, no need to catch up any further.
+        if ((now_us - m_last_tick_us) >= tick_us) {
+            m_last_tick_us = now_us;
+        }
     }
 
-    if (input_state.controller.dpad.left && input_state.controller.dpad.right) {
-        if (m_socd_state.lastHorizontal == Id::RIGHT) {
-            input_state.controller.dpad.right = false;
-        } else if (m_socd_state.lastHorizontal == Id::LEFT) {
-            input_state.controller.dpad.left = false;
+    const uint32_t locked = m_lockout[0] | m_lockout[1] | m_lockout[2];
+    const uint32_t changed = (raw ^ m_state) & ~locked;
+
+    // Apply changes immediately and (re)load the lockout counter of each changed pin.
+    m_state ^= changed;
+    m_lockout[0] |= changed;
+    m_lockout[1] |= changed;
+    m_lockout[2] |= changed;
+
+    return m_state;
+}
+
+void Buttons::socdClean(Utils::InputState &input_state) {
+    const auto &tables = socd_tables[static_cast<size_t>(m_config.socd_mode)];
+
+    const auto resolve = [](const SocdTable &table, SocdState::Axis &axis, const uint8_t input) {
+        const uint8_t output = table[axis.previous_input | (input << 2) | (axis.previous_output << 4)];
+
+        axis.previous_input = input;
+        axis.previous_output = output;
+
+        return output;
+    };
+
+    auto &dpad = input_state.controller.dpad;
+
+    const uint8_t vertical = resolve(tables[0], m_socd_state.vertical, dpad.up | (dpad.down << 1));
+    const uint8_t horizontal = resolve(tables[1], m_socd_state.horizontal, dpad.left | (dpad.right << 1));
+
+    dpad.up = vertical & 0b01;
+    dpad.down = vertical & 0b10;
+    dpad.left = horizontal & 0b01;
+    dpad.right = horizontal & 0b10;
+}
+
+Buttons::InternalGpio::InternalGpio(const Config::InternalGpio &config, const uint32_t pin_mask)
+    : m_pin_mask(pin_mask) {
+    (void)config;
+
+    gpio_init_mask(m_pin_mask);
+    gpio_set_dir_in_masked(m_pin_mask);
+
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; ++pin) {
+        if (m_pin_mask & (1 << pin)) {
+            gpio_pull_up(pin);
         }
-    } else if (input_state.controller.dpad.left) {
-        m_socd_state.lastHorizontal = Id::LEFT;
-    } else {
-        m_socd_state.lastHorizontal = Id::RIGHT;
     }
 }
 
-Buttons::Buttons(const Config &config) : m_config(config), m_socd_state{Id::DOWN, Id::RIGHT} {
-    m_mcp23017 = std::make_unique<Mcp23017>(m_config.i2c.address, m_config.i2c.block);
-    m_mcp23017->setDirection(0xFFFF);       // All inputs
-    m_mcp23017->setPullup(0xFFFF);          // All on
-    m_mcp23017->setReversePolarity(0xFFFF); // All reversed
-
-    m_buttons.emplace(Id::UP, config.pins.dpad.up);
-    m_buttons.emplace(Id::DOWN, config.pins.dpad.down);
-    m_buttons.emplace(Id::LEFT, config.pins.dpad.left);
-    m_buttons.emplace(Id::RIGHT, config.pins.dpad.right);
-    m_buttons.emplace(Id::NORTH, config.pins.buttons.north);
-    m_buttons.emplace(Id::EAST, config.pins.buttons.east);
-    m_buttons.emplace(Id::SOUTH, config.pins.buttons.south);
-    m_buttons.emplace(Id::WEST, config.pins.buttons.west);
-    m_buttons.emplace(Id::L, config.pins.buttons.l);
-    m_buttons.emplace(Id::R, config.pins.buttons.r);
-    m_buttons.emplace(Id::START, config.pins.buttons.start);
-    m_buttons.emplace(Id::SELECT, config.pins.buttons.select);
-    m_buttons.emplace(Id::HOME, config.pins.buttons.home);
-    m_buttons.emplace(Id::SHARE, config.pins.buttons.share);
+// Buttons are active low, a single SIO read covers all of them.
+uint32_t Buttons::InternalGpio::read() { return ~gpio_get_all() & m_pin_mask; }
+
+Buttons::ExternalGpio::ExternalGpio(const Config::ExternalGpio &config)
+    : m_mcp23017(config.i2c_address, config.i2c_block),
+      m_use_interrupt(config.interrupt_pin != Config::ExternalGpio::no_interrupt_pin), m_gpio_state(0),
+      m_last_read(0) {
+    m_mcp23017.setDirection(0xFFFF);       // All inputs
+    m_mcp23017.setPullup(0xFFFF);          // All on
+    m_mcp23017.setReversePolarity(0xFFFF); // All reversed
+
+    if (!m_use_interrupt) {
+        return;
+    }
+
+    // Mirror INTA/INTB to a single open-drain, active-low line which fires on any pin change.
+    m_mcp23017.setInterruptConfig(Mcp23017::Iocon::MIRROR | Mcp23017::Iocon::ODR);
+    m_mcp23017.setInterruptCompare(0x0000, 0x0000);
+    m_mcp23017.setInterruptEnable(0xFFFF);
+
+    // The IRQ is registered on the calling core, so this needs to be constructed on the core
+    // which will also call updateInputState().
+    mcp23017_interrupt_pin = config.interrupt_pin;
+    gpio_init(config.interrupt_pin);
+    gpio_set_dir(config.interrupt_pin, GPIO_IN);
+    gpio_pull_up(config.interrupt_pin);
+    gpio_set_irq_enabled_with_callback(config.interrupt_pin, GPIO_IRQ_EDGE_FALL, true, &mcp23017_interrupt_handler);
 }
 
-void Buttons::updateInputState(Utils::InputState &input_state) {
-    uint16_t gpio_state = m_mcp23017->read();
+uint32_t Buttons::ExternalGpio::read() {
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+
+    // Without interrupt line the expander is read on every call. Otherwise only talk to it if it
+    // signaled a change, but poll once in a while in case we missed an edge.
+    if (!m_use_interrupt || mcp23017_interrupt_pending || (now - m_last_read) >= m_poll_interval_ms) {
+        // Clear before reading, reading the port will release the interrupt line and any
+        // change after this point will raise a new edge.
+        mcp23017_interrupt_pending = false;
+
+        m_gpio_state = m_mcp23017.read();
+        m_last_read = now;
+    }
 
-    for (auto &button : m_buttons) {
-        button.second.setState(gpio_state & button.second.getGpioMask(), m_config.debounce_delay_ms);
+    return m_gpio_state;
+}
+
+Buttons::Buttons(const Config &config) : m_config(config), m_socd_state{{0, 0}, {0, 0}} {
+    // Indexed by Id
+    m_pin_masks = {
+        1u << config.pins.dpad.up,        //
+        1u << config.pins.dpad.down,      //
+        1u << config.pins.dpad.left,      //
+        1u << config.pins.dpad.right,     //
+        1u << config.pins.buttons.north,  //
+        1u << config.pins.buttons.east,   //
+        1u << config.pins.buttons.south,  //
+        1u << config.pins.buttons.west,   //
+        1u << config.pins.buttons.l,      //
+        1u << config.pins.buttons.r,      //
+        1u << config.pins.buttons.start,  //
+        1u << config.pins.buttons.select, //
+        1u << config.pins.buttons.home,   //
+        1u << config.pins.buttons.share,  //
+    };
+
+    uint32_t pin_mask = 0;
+    for (const auto mask : m_pin_masks) {
+        pin_mask |= mask;
     }
 
-    input_state.controller.dpad.up = m_buttons.at(Id::UP).getState();
-    input_state.controller.dpad.down = m_buttons.at(Id::DOWN).getState();
-    input_state.controller.dpad.left = m_buttons.at(Id::LEFT).getState();
-    input_state.controller.dpad.right = m_buttons.at(Id::RIGHT).getState();
-    input_state.controller.buttons.north = m_buttons.at(Id::NORTH).getState();
-    input_state.controller.buttons.east = m_buttons.at(Id::EAST).getState();
-    input_state.controller.buttons.south = m_buttons.at(Id::SOUTH).getState();
-    input_state.controller.buttons.west = m_buttons.at(Id::WEST).getState();
-    input_state.controller.buttons.l = m_buttons.at(Id::L).getState();
-    input_state.controller.buttons.r = m_buttons.at(Id::R).getState();
-    input_state.controller.buttons.start = m_buttons.at(Id::START).getState();
-    input_state.controller.buttons.select = m_buttons.at(Id::SELECT).getState();
-    input_state.controller.buttons.home = m_buttons.at(Id::HOME).getState();
-    input_state.controller.buttons.share = m_buttons.at(Id::SHARE).getState();
+    std::visit(
+        [this, pin_mask](auto &&config) {
+            using T = std::decay_t<decltype(config)>;
+
+            if constexpr (std::is_same_v<T, Config::InternalGpio>) {
+                m_gpio = std::make_unique<InternalGpio>(config, pin_mask);
+            } else if constexpr (std::is_same_v<T, Config::ExternalGpio>) {
+                m_gpio = std::make_unique<ExternalGpio>(config);
+            } else {
+                static_assert(false, "Unknown GPIO type!");
+            }
+        },
+        m_config.gpio_config);
+}
+
+void Buttons::updateInputState(Utils::InputState &input_state) {
+    TRACE_SCOPE(TRACE_BUTTONS_UPDATE, 0);
+
+    const uint32_t now_us = to_us_since_boot(get_absolute_time());
+
+    // Debouncing still needs to run on cached values, since a change might have been suppressed earlier.
+    const uint32_t state = m_debouncer.update(m_gpio->read(), now_us, m_config.debounce_delay_ms);
+
+    const auto is_pressed = [&](Id id) { return (state & m_pin_masks[static_cast<size_t>(id)]) != 0; };
+
+    input_state.controller.dpad.up = is_pressed(Id::UP);
+    input_state.controller.dpad.down = is_pressed(Id::DOWN);
+    input_state.controller.dpad.left = is_pressed(Id::LEFT);
+    input_state.controller.dpad.right = is_pressed(Id::RIGHT);
+    input_state.controller.buttons.north = is_pressed(Id::NORTH);
+    input_state.controller.buttons.east = is_pressed(Id::EAST);
+    input_state.controller.buttons.south = is_pressed(Id::SOUTH);
+    input_state.controller.buttons.west = is_pressed(Id::WEST);
+    input_state.controller.buttons.l = is_pressed(Id::L);
+    input_state.controller.buttons.r = is_pressed(Id::R);
+    input_state.controller.buttons.start = is_pressed(Id::START);
+    input_state.controller.buttons.select = is_pressed(Id::SELECT);
+    input_state.controller.buttons.home = is_pressed(Id::HOME);
+    input_state.controller.buttons.share = is_pressed(Id::SHARE);
 
     socdClean(input_state);
 }
+
+void Buttons::setSocdMode(const SocdMode mode) {
+    switch (mode) {
+    case SocdMode::LastWins:
+    case SocdMode::FirstWins:
+    case SocdMode::Neutral:
+    case SocdMode::UpPriority:
+        m_config.socd_mode = mode;
+        return;
+    }
+
+    m_config.socd_mode = SocdMode::LastWins;
+}
+
 } // namespace Doncon::Peripherals
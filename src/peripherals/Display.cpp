@@ -1,33 +1,83 @@
 #include "peripherals/Display.h"
 
+#include "utils/Trace.h"
+
 #include "hardware/gpio.h"
 #include "pico/time.h"
 
 #include "bitmaps/MenuScreens.h"
 
+#include <algorithm>
 #include <list>
 #include <numeric>
-#include <string>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
 
 namespace Doncon::Peripherals {
 
 Display::Display(const Config &config)
-    : m_config(config), m_state(State::Idle), m_input_state({}), m_usb_mode(USB_MODE_DEBUG), m_player_id(0) {
+    : m_config(config), m_state(State::Idle), m_input_state({}), m_usb_mode(USB_MODE_DEBUG), m_player_id(0),
+      m_pad_levels({}), m_latency_report({}), m_loop_reports({}) {
     m_display.external_vcc = false;
     ssd1306_init(&m_display, 128, 64, m_config.i2c_address, m_config.i2c_block);
     ssd1306_clear(&m_display);
+
+    m_next_page = m_display.pages;
 }
 
 void Display::setInputState(const Utils::InputState &state) { m_input_state = state; }
 void Display::setUsbMode(usb_mode_t mode) { m_usb_mode = mode; };
 void Display::setPlayerId(uint8_t player_id) { m_player_id = player_id; };
 
+void Display::trackDrum(const Utils::InputState::Drum &drum) {
+    static const uint32_t peak_hold_ms = 1000;
+
+    const std::array<const Utils::InputState::Drum::Pad *, 4> pads = {&drum.don_left, &drum.ka_left, &drum.don_right,
+                                                                     &drum.ka_right};
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+
+    for (size_t idx = 0; idx < pads.size(); ++idx) {
+        // The analog value is the windowed maximum of the raw level, scaled to 16 bit.
+        const uint16_t level = pads[idx]->analog >> 4;
+        auto &pad_level = m_pad_levels[idx];
+
+        pad_level.frame_max = std::max(pad_level.frame_max, level);
+        if (level >= pad_level.peak || (now - pad_level.peak_since_ms) > peak_hold_ms) {
+            pad_level.peak = level;
+            pad_level.peak_since_ms = now;
+        }
+        if (pads[idx]->triggered) {
+            pad_level.triggered_ms = now;
+        }
+    }
+}
+
 void Display::setMenuState(const Utils::Menu::State &menu_state) { m_menu_state = menu_state; }
+void Display::receiveLatencyReport(queue_t *queue) { queue_try_remove(queue, &m_latency_report); }
+void Display::receiveLoopReport(uint8_t core, queue_t *queue) { queue_try_remove(queue, &m_loop_reports.at(core)); }
+void Display::setLoopReport(uint8_t core, const Utils::LoopProfiler::Report &report) {
+    m_loop_reports.at(core) = report;
+}
 
 void Display::showIdle() { m_state = State::Idle; }
 void Display::showMenu() { m_state = State::Menu; }
 
-static std::string modeToString(usb_mode_t mode) {
+// Text is formatted into fixed buffers, the display task is not supposed to allocate. One line of the
+// small font holds 21 characters.
+using TextBuffer = std::array<char, 22>;
+
+static size_t formatText(TextBuffer &buffer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static size_t formatText(TextBuffer &buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(buffer.data(), buffer.size(), format, args);
+    va_end(args);
+
+    return std::min<size_t>(std::max(length, 0), buffer.size() - 1);
+}
+
+static const char *modeToString(usb_mode_t mode) {
     switch (mode) {
     case USB_MODE_SWITCH_TATACON:
         return "Switch Tatacon";
@@ -59,15 +109,18 @@ static std::string modeToString(usb_mode_t mode) {
 
 void Display::drawIdleScreen() {
     // Header
-    std::string mode_string = modeToString(m_usb_mode) + " mode";
-    ssd1306_draw_string(&m_display, 0, 0, 1, mode_string.c_str());
+    TextBuffer mode_str;
+    formatText(mode_str, "%s mode", modeToString(m_usb_mode));
+    ssd1306_draw_string(&m_display, 0, 0, 1, mode_str.data());
     ssd1306_draw_line(&m_display, 0, 10, 128, 10);
 
     // Roll counter
-    auto roll_str = std::to_string(m_input_state.drum.current_roll) + " Roll";
-    auto prev_roll_str = "Last " + std::to_string(m_input_state.drum.previous_roll);
-    ssd1306_draw_string(&m_display, (127 - (roll_str.length() * 12)) / 2, 20, 2, roll_str.c_str());
-    ssd1306_draw_string(&m_display, (127 - (prev_roll_str.length() * 6)) / 2, 40, 1, prev_roll_str.c_str());
+    TextBuffer roll_str;
+    TextBuffer prev_roll_str;
+    const auto roll_length = formatText(roll_str, "%u Roll", m_input_state.drum.current_roll);
+    const auto prev_roll_length = formatText(prev_roll_str, "Last %u", m_input_state.drum.previous_roll);
+    ssd1306_draw_string(&m_display, (127 - (roll_length * 12)) / 2, 20, 2, roll_str.data());
+    ssd1306_draw_string(&m_display, (127 - (prev_roll_length * 6)) / 2, 40, 1, prev_roll_str.data());
 
     // Player "LEDs"
     if (m_player_id != 0) {
@@ -85,14 +138,29 @@ void Display::drawIdleScreen() {
     ssd1306_draw_string(&m_display, 0, 56, 1, "Hold STA+SEL for Menu");
 }
 
-void Display::drawMenuScreen() {
-    auto descriptor_it = Utils::Menu::descriptors.find(m_menu_state.page);
-    if (descriptor_it == Utils::Menu::descriptors.end()) {
-        return;
+// Index of the pad in m_pad_levels whose threshold is edited on the page, 4 if there is none.
+static size_t getThresholdPad(Utils::Menu::Page page) {
+    switch (page) {
+    case Utils::Menu::Page::DrumTriggerThresholdDonLeft:
+        return 0;
+    case Utils::Menu::Page::DrumTriggerThresholdKaLeft:
+        return 1;
+    case Utils::Menu::Page::DrumTriggerThresholdDonRight:
+        return 2;
+    case Utils::Menu::Page::DrumTriggerThresholdKaRight:
+        return 3;
+    default:
+        break;
     }
 
+    return 4;
+}
+
+void Display::drawMenuScreen() {
+    const auto &descriptor = Utils::Menu::getDescriptor(m_menu_state.page);
+
     // Background
-    switch (descriptor_it->second.type) {
+    switch (descriptor.type) {
     case Utils::Menu::Descriptor::Type::Menu:
         if (m_menu_state.page == Utils::Menu::Page::Main) {
             ssd1306_bmp_show_image(&m_display, menu_screen_top.data(), menu_screen_top.size());
@@ -107,35 +175,71 @@ void Display::drawMenuScreen() {
     case Utils::Menu::Descriptor::Type::Toggle:
         ssd1306_bmp_show_image(&m_display, menu_screen_sub.data(), menu_screen_sub.size());
         break;
+    case Utils::Menu::Descriptor::Type::Info:
     case Utils::Menu::Descriptor::Type::RebootInfo:
         break;
     }
 
     // Heading
-    ssd1306_draw_string(&m_display, 0, 0, 1, descriptor_it->second.name.c_str());
+    TextBuffer heading;
+    formatText(heading, "%.*s", static_cast<int>(descriptor.name.size()), descriptor.name.data());
+    ssd1306_draw_string(&m_display, 0, 0, 1, heading.data());
+
+    // Info pages draw their own content
+    if (descriptor.type == Utils::Menu::Descriptor::Type::Info) {
+        ssd1306_draw_line(&m_display, 0, 10, 128, 10);
+
+        if (m_menu_state.page == Utils::Menu::Page::Latency) {
+            drawLatencyPage();
+        } else if (m_menu_state.page == Utils::Menu::Page::LoopProfile) {
+            drawLoopProfilePage();
+        }
+        return;
+    }
 
     // Current Selection
-    std::string selection;
-    switch (descriptor_it->second.type) {
+    TextBuffer selection;
+    size_t selection_length = 0;
+    switch (descriptor.type) {
     case Utils::Menu::Descriptor::Type::Menu:
     case Utils::Menu::Descriptor::Type::Selection:
-    case Utils::Menu::Descriptor::Type::RebootInfo:
-        selection = descriptor_it->second.items.at(m_menu_state.selected_value).first;
-        break;
+    case Utils::Menu::Descriptor::Type::Info:
+    case Utils::Menu::Descriptor::Type::RebootInfo: {
+        const auto &name = descriptor.items[m_menu_state.selected_value].name;
+        selection_length = formatText(selection, "%.*s", static_cast<int>(name.size()), name.data());
+    } break;
     case Utils::Menu::Descriptor::Type::Value:
-        selection = std::to_string(m_menu_state.selected_value);
+        selection_length = formatText(selection, "%u", m_menu_state.selected_value);
         break;
     case Utils::Menu::Descriptor::Type::Toggle:
-        selection = m_menu_state.selected_value ? "On" : "Off";
+        selection_length = formatText(selection, "%s", m_menu_state.selected_value ? "On" : "Off");
         break;
     }
-    ssd1306_draw_string(&m_display, (127 - (selection.length() * 12)) / 2, 15, 2, selection.c_str());
+
+    const auto pad = getThresholdPad(m_menu_state.page);
+    if (pad < m_pad_levels.size()) {
+        // Make room for the live level of the pad next to the threshold.
+        ssd1306_draw_string(&m_display, 4, 15, 2, selection.data());
+
+        TextBuffer peak_str;
+        const auto peak_length = formatText(peak_str, "Hit %u", m_pad_levels[pad].peak);
+        ssd1306_draw_string(&m_display, 128 - (peak_length * 6), 14, 1, peak_str.data());
+
+        drawThresholdMeter(m_pad_levels[pad], m_menu_state.selected_value, descriptor.max_value);
+    } else {
+        ssd1306_draw_string(&m_display, (127 - (selection_length * 12)) / 2, 15, 2, selection.data());
+    }
+
+    if (descriptor.type == Utils::Menu::Descriptor::Type::Value) {
+        const char *step_str = m_menu_state.coarse ? "Coarse" : "Fine";
+        ssd1306_draw_string(&m_display, 128 - (strlen(step_str) * 6), 23, 1, step_str);
+    }
 
     // Breadcrumbs
-    switch (descriptor_it->second.type) {
+    switch (descriptor.type) {
     case Utils::Menu::Descriptor::Type::Menu:
     case Utils::Menu::Descriptor::Type::Selection: {
-        auto selection_count = descriptor_it->second.items.size();
+        auto selection_count = descriptor.item_count;
         for (uint8_t i = 0; i < selection_count; ++i) {
             if (i == m_menu_state.selected_value) {
                 ssd1306_draw_square(&m_display, ((127) - ((selection_count - i) * 6)) - 1, 2, 4, 4);
@@ -148,18 +252,107 @@ void Display::drawMenuScreen() {
         break;
     case Utils::Menu::Descriptor::Type::Value:
     case Utils::Menu::Descriptor::Type::Toggle:
+    case Utils::Menu::Descriptor::Type::Info:
         break;
     }
 }
 
-void Display::update() {
-    static const uint32_t interval_ms = 17; // Limit to ~60fps
-    static uint32_t start_ms = 0;
+void Display::drawThresholdMeter(const PadLevel &level, uint16_t threshold, uint16_t max_value) {
+    static const uint32_t trigger_flash_ms = 150;
+
+    static const uint8_t meter_y = 32;
+    static const uint8_t meter_height = 3;
+    static const uint8_t indicator_x = 60;
+    static const uint8_t indicator_y = 16;
+    static const uint8_t indicator_size = 13;
+
+    const auto to_x = [max_value](uint16_t value) { return std::min<uint32_t>(value, max_value) * 127 / max_value; };
+
+    // Level since the last frame as bar, the held peak as tick and the threshold as line crossing the bar.
+    const auto level_x = to_x(level.frame_max);
+    if (level_x != 0) {
+        ssd1306_draw_square(&m_display, 0, meter_y, level_x, meter_height);
+    }
+    const auto peak_x = to_x(level.peak);
+    ssd1306_draw_line(&m_display, peak_x, meter_y, peak_x, meter_y + meter_height - 1);
+    const auto threshold_x = to_x(threshold);
+    ssd1306_draw_line(&m_display, threshold_x, meter_y - 2, threshold_x, meter_y + meter_height);
+
+    // Hit indicator, filled while the pad has triggered recently.
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+    if ((now - level.triggered_ms) < trigger_flash_ms) {
+        ssd1306_draw_square(&m_display, indicator_x, indicator_y, indicator_size, indicator_size);
+    } else {
+        const uint8_t end = indicator_size - 1;
+        ssd1306_draw_line(&m_display, indicator_x, indicator_y, indicator_x + end, indicator_y);
+        ssd1306_draw_line(&m_display, indicator_x, indicator_y + end, indicator_x + end, indicator_y + end);
+        ssd1306_draw_line(&m_display, indicator_x, indicator_y, indicator_x, indicator_y + end);
+        ssd1306_draw_line(&m_display, indicator_x + end, indicator_y, indicator_x + end, indicator_y + end);
+    }
+}
 
-    if (to_ms_since_boot(get_absolute_time()) - start_ms < interval_ms) {
+void Display::drawLatencyPage() {
+    const auto &total = m_latency_report.spans[static_cast<size_t>(Utils::LatencyTracker::Span::Total)];
+
+    if (total.count == 0) {
+        ssd1306_draw_string(&m_display, 0, 14, 1, "Hit the drum...");
         return;
     }
-    start_ms += interval_ms;
+
+    // Summary of the whole chain from ADC sample to completed USB transfer
+    TextBuffer avg_str;
+    TextBuffer range_str;
+    formatText(avg_str, "n %lu avg %luus", static_cast<unsigned long>(total.count),
+               static_cast<unsigned long>(total.sum_us / total.count));
+    formatText(range_str, "%lu-%luus", static_cast<unsigned long>(total.min_us),
+               static_cast<unsigned long>(total.max_us));
+    ssd1306_draw_string(&m_display, 0, 13, 1, avg_str.data());
+    ssd1306_draw_string(&m_display, 0, 22, 1, range_str.data());
+
+    // Histogram, one bar per bucket scaled to the largest one
+    static const uint8_t bar_width = 7;
+    static const uint8_t bar_max_height = 30;
+
+    const auto max_count = *std::max_element(total.buckets.cbegin(), total.buckets.cend());
+    for (size_t idx = 0; idx < total.buckets.size(); ++idx) {
+        const auto height =
+            static_cast<uint32_t>((static_cast<uint64_t>(total.buckets[idx]) * bar_max_height) / max_count);
+
+        if (height > 0) {
+            ssd1306_draw_square(&m_display, idx * bar_width, 64 - height, bar_width - 1, height);
+        }
+    }
+}
+
+void Display::drawLoopProfilePage() {
+    for (uint8_t core = 0; core < m_loop_reports.size(); ++core) {
+        const auto &report = m_loop_reports[core];
+        const uint32_t y = 13 + core * 25;
+
+        TextBuffer rate_str;
+        if (report.iterations == 0) {
+            formatText(rate_str, "Core%u -", core);
+            ssd1306_draw_string(&m_display, 0, y, 1, rate_str.data());
+            continue;
+        }
+
+        TextBuffer time_str;
+        formatText(rate_str, "Core%u %lu/s", core,
+                   static_cast<unsigned long>((report.iterations * 1000000ULL) / report.sum_us));
+        formatText(time_str, "%lu/%lu/%luus", static_cast<unsigned long>(report.min_us),
+                   static_cast<unsigned long>(report.sum_us / report.iterations),
+                   static_cast<unsigned long>(report.max_us));
+        ssd1306_draw_string(&m_display, 0, y, 1, rate_str.data());
+        ssd1306_draw_string(&m_display, 0, y + 9, 1, time_str.data());
+    }
+}
+
+void Display::update() {
+    if (m_next_page < m_display.pages) {
+        return;
+    }
+
+    TRACE_SCOPE(TRACE_DISPLAY_UPDATE, 0);
 
     ssd1306_clear(&m_display);
 
@@ -172,7 +365,21 @@ void Display::update() {
         break;
     }
 
-    ssd1306_show(&m_display);
+    for (auto &level : m_pad_levels) {
+        level.frame_max = 0;
+    }
+
+    m_next_page = 0;
 };
 
+bool Display::transfer() {
+    if (m_next_page >= m_display.pages) {
+        return false;
+    }
+
+    ssd1306_show_page(&m_display, m_next_page++);
+
+    return true;
+}
+
 } // namespace Doncon::Peripherals
\ No newline at end of file
@@ -1,14 +1,16 @@
 #include "peripherals/Drum.h"
 
+#include "utils/HotPath.h"
+
 #include "hardware/adc.h"
 #include "pico/time.h"
 
 #include <algorithm>
-#include <deque>
 
 namespace Doncon::Peripherals {
 
-Drum::InternalAdc::InternalAdc(const Config::InternalAdc &config) : m_config(config) {
+Drum::InternalAdc::InternalAdc(const Config::InternalAdc &config)
+    : m_config(config), m_counters({}), m_cycle_start_us(0) {
     static const uint adc_base_pin = 26;
 
     for (uint pin = adc_base_pin; pin < adc_base_pin + 4; ++pin) {
@@ -18,7 +20,10 @@ Drum::InternalAdc::InternalAdc(const Config::InternalAdc &config) : m_config(con
     adc_init();
 }
 
-std::array<uint16_t, 4> Drum::InternalAdc::read() {
+std::array<uint16_t, 4> DONCON_HOT_FUNC(Drum::InternalAdc::read)(std::array<uint32_t, 4> &sample_times_us) {
+    const uint32_t start_us = to_us_since_boot(get_absolute_time());
+    sample_times_us.fill(start_us);
+
     // Oversample ADC inputs to get rid of ADC noise
     std::array<uint32_t, 4> values{};
     for (uint8_t sample_number = 0; sample_number < m_config.sample_count; ++sample_number) {
@@ -32,8 +37,19 @@ std::array<uint16_t, 4> Drum::InternalAdc::read() {
     std::array<uint16_t, 4> result{};
     for (size_t idx = 0; idx < values.size(); ++idx) {
         result[idx] = values[idx] / m_config.sample_count;
+        m_counters.conversions[idx] += m_config.sample_count;
     }
 
+    const uint32_t cycle_us = static_cast<uint32_t>(to_us_since_boot(get_absolute_time())) - start_us;
+    m_counters.max_cycle_us = std::max(m_counters.max_cycle_us, cycle_us);
+
+    return result;
+}
+
+Drum::AdcInterface::Counters Drum::InternalAdc::takeCounters() {
+    const auto result = m_counters;
+    m_counters.max_cycle_us = 0;
+
     return result;
 }
 
@@ -55,11 +71,19 @@ Drum::ExternalAdc::ExternalAdc(const Config::ExternalAdc &config) : m_mcp3204(co
     m_mcp3204.run();
 }
 
-std::array<uint16_t, 4> Drum::ExternalAdc::read() { return m_mcp3204.take_maximums(); }
+std::array<uint16_t, 4> DONCON_HOT_FUNC(Drum::ExternalAdc::read)(std::array<uint32_t, 4> &sample_times_us) {
+    return m_mcp3204.take_maximums(sample_times_us);
+}
+
+Drum::AdcInterface::Counters Drum::ExternalAdc::takeCounters() {
+    const auto stats = m_mcp3204.take_stats();
+
+    return {stats.conversions, stats.read_irqs + stats.alarm_irqs, stats.irq_busy_us, stats.max_cycle_us};
+}
 
 Drum::Pad::Pad(const uint8_t channel) : channel(channel), last_change(0), active(false) {}
 
-void Drum::Pad::setState(const bool state, const uint16_t debounce_delay) {
+void DONCON_HOT_FUNC(Drum::Pad::setState)(const bool state, const uint16_t debounce_delay) {
     if (active == state) {
         return;
     }
@@ -72,7 +96,43 @@ void Drum::Pad::setState(const bool state, const uint16_t debounce_delay) {
     }
 }
 
-Drum::Drum(const Config &config) : m_config(config) {
+void DONCON_HOT_FUNC(Drum::PeakWindow::update)(const uint16_t value, const uint32_t now_ms,
+                                               const uint16_t window_ms) {
+    // Clear outdated values, i.e. anything older than window_ms.
+    while (count != 0 && static_cast<uint16_t>(now_ms - entries[head].timestamp_ms) >= window_ms) {
+        head = (head + 1) % capacity;
+        count--;
+    }
+
+    // Samples within the same millisecond share an entry, if the window is still full the oldest one is dropped.
+    auto &last = entries[(head + count + capacity - 1) % capacity];
+    if (count != 0 && last.timestamp_ms == static_cast<uint16_t>(now_ms)) {
+        last.value = std::max(last.value, value);
+        return;
+    }
+
+    if (count == capacity) {
+        head = (head + 1) % capacity;
+        count--;
+    }
+
+    entries[(head + count) % capacity] = {value, static_cast<uint16_t>(now_ms)};
+    count++;
+}
+
+uint16_t DONCON_HOT_FUNC(Drum::PeakWindow::getMax)() const {
+    uint16_t result = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        result = std::max(result, entries[(head + idx) % capacity].value);
+    }
+
+    return result;
+}
+
+Drum::Drum(const Config &config)
+    : m_config(config), m_pads({Pad(config.adc_channels.don_left), Pad(config.adc_channels.ka_left),
+                                Pad(config.adc_channels.don_right), Pad(config.adc_channels.ka_right)}),
+      m_sample_times_us({}), m_adc_counters({}), m_adc_stats_start_us(0), m_adc_stats({}) {
 
     std::visit(
         [this](auto &&config) {
@@ -88,25 +148,23 @@ Drum::Drum(const Config &config) : m_config(config) {
         },
         m_config.adc_config);
 
-    m_pads.emplace(Id::DON_LEFT, config.adc_channels.don_left);
-    m_pads.emplace(Id::KA_LEFT, config.adc_channels.ka_left);
-    m_pads.emplace(Id::DON_RIGHT, config.adc_channels.don_right);
-    m_pads.emplace(Id::KA_RIGHT, config.adc_channels.ka_right);
+    m_adc_counters = m_adc->takeCounters();
+    m_adc_stats_start_us = to_us_since_boot(get_absolute_time());
 }
 
-std::map<Drum::Id, uint16_t> Drum::readInputs() {
-    std::map<Id, uint16_t> result;
+Drum::ById<uint16_t> DONCON_HOT_FUNC(Drum::readInputs)() {
+    ById<uint16_t> result = {};
 
-    const auto adc_values = m_adc->read();
+    const auto adc_values = m_adc->read(m_sample_times_us);
 
-    for (const auto &pad : m_pads) {
-        result[pad.first] = adc_values[pad.second.getChannel()];
+    for (const auto id : pad_ids) {
+        result[id] = adc_values[m_pads[id].getChannel()];
     }
 
     return result;
 }
 
-void Drum::updateRollCounter(Utils::InputState &input_state) {
+void DONCON_HOT_FUNC(Drum::updateRollCounter)(Utils::InputState &input_state) {
     static uint32_t last_hit_time = 0;
     static bool last_don_left_state = false;
     static bool last_don_right_state = false;
@@ -149,9 +207,10 @@ void Drum::updateRollCounter(Utils::InputState &input_state) {
     input_state.drum.previous_roll = previous_roll;
 }
 
-void Drum::updateDigitalInputState(Utils::InputState &input_state, const std::map<Drum::Id, uint16_t> &raw_values) {
+void DONCON_HOT_FUNC(Drum::updateDigitalInputState)(Utils::InputState &input_state,
+                                                    const ById<uint16_t> &raw_values) {
 
-    std::map<Drum::Id, uint16_t> filtered_raw_values;
+    ById<uint16_t> filtered_raw_values = {};
 
     // First zero everything below its threshold.
     const auto value_if_above_threshold = [](const auto &values, const auto &thresholds, Id target) {
@@ -169,47 +228,46 @@ void Drum::updateDigitalInputState(Utils::InputState &input_state, const std::ma
             assert(false);
             return (uint16_t)0;
         };
-        return (values.at(target) > get_threshold(target)) ? values.at(target) : (uint16_t)0;
+        return (values[target] > get_threshold(target)) ? values[target] : (uint16_t)0;
     };
 
-    for (const auto &entry : raw_values) {
-        filtered_raw_values.insert(
-            {entry.first, value_if_above_threshold(raw_values, m_config.trigger_thresholds, entry.first)});
+    for (const auto id : pad_ids) {
+        filtered_raw_values[id] = value_if_above_threshold(raw_values, m_config.trigger_thresholds, id);
     }
 
     // Only DON or KA can be active at a time, zero the lesser
-    if (std::max(filtered_raw_values.at(Id::DON_LEFT), filtered_raw_values.at(Id::DON_RIGHT)) >
-        std::max(filtered_raw_values.at(Id::KA_LEFT), filtered_raw_values.at(Id::KA_RIGHT))) {
+    if (std::max(filtered_raw_values[Id::DON_LEFT], filtered_raw_values[Id::DON_RIGHT]) >
+        std::max(filtered_raw_values[Id::KA_LEFT], filtered_raw_values[Id::KA_RIGHT])) {
 
-        filtered_raw_values.at(Id::KA_LEFT) = 0;
-        filtered_raw_values.at(Id::KA_RIGHT) = 0;
+        filtered_raw_values[Id::KA_LEFT] = 0;
+        filtered_raw_values[Id::KA_RIGHT] = 0;
     } else {
-        filtered_raw_values.at(Id::DON_LEFT) = 0;
-        filtered_raw_values.at(Id::DON_RIGHT) = 0;
+        filtered_raw_values[Id::DON_LEFT] = 0;
+        filtered_raw_values[Id::DON_RIGHT] = 0;
     }
 
     // Check same same with regard to current debounce state
-    if (m_pads.at(Id::DON_LEFT).getState() || m_pads.at(Id::DON_RIGHT).getState()) {
-        filtered_raw_values.at(Id::KA_LEFT) = 0;
-        filtered_raw_values.at(Id::KA_RIGHT) = 0;
-    } else if (m_pads.at(Id::KA_LEFT).getState() || m_pads.at(Id::KA_RIGHT).getState()) {
-        filtered_raw_values.at(Id::DON_LEFT) = 0;
-        filtered_raw_values.at(Id::DON_RIGHT) = 0;
+    if (m_pads[Id::DON_LEFT].getState() || m_pads[Id::DON_RIGHT].getState()) {
+        filtered_raw_values[Id::KA_LEFT] = 0;
+        filtered_raw_values[Id::KA_RIGHT] = 0;
+    } else if (m_pads[Id::KA_LEFT].getState() || m_pads[Id::KA_RIGHT].getState()) {
+        filtered_raw_values[Id::DON_LEFT] = 0;
+        filtered_raw_values[Id::DON_RIGHT] = 0;
     }
 
     // Zero values which are not within +/- 50% of their twin pad
     const auto zero_if_not_within_twin = [](auto &values, Id a, Id b) {
-        if (values.at(a) == 0 || values.at(b) == 0) {
+        if (values[a] == 0 || values[b] == 0) {
             return;
         }
 
-        if (values.at(a) > values.at(b)) {
-            if (values.at(b) < (values.at(a) >> 1)) {
-                values.at(b) = 0;
+        if (values[a] > values[b]) {
+            if (values[b] < (values[a] >> 1)) {
+                values[b] = 0;
             }
         } else {
-            if (values.at(a) < (values.at(b) >> 1)) {
-                values.at(a) = 0;
+            if (values[a] < (values[b] >> 1)) {
+                values[a] = 0;
             }
         }
     };
@@ -218,79 +276,96 @@ void Drum::updateDigitalInputState(Utils::InputState &input_state, const std::ma
     zero_if_not_within_twin(filtered_raw_values, Id::KA_LEFT, Id::KA_RIGHT);
 
     // All values != 0 are already over their threshold.
-    for (const auto &entry : filtered_raw_values) {
-        if (entry.second != 0) {
-            m_pads.at(entry.first).setState(true, m_config.debounce_delay_ms);
+    for (const auto id : pad_ids) {
+        auto &pad = m_pads[id];
+        const bool was_active = pad.getState();
+
+        if (filtered_raw_values[id] != 0) {
+            pad.setState(true, m_config.debounce_delay_ms);
         } else {
-            m_pads.at(entry.first).setState(false, m_config.debounce_delay_ms);
+            pad.setState(false, m_config.debounce_delay_ms);
+        }
+
+        if (!was_active && pad.getState()) {
+            input_state.drum.hit_sample_us = m_sample_times_us[pad.getChannel()];
+            input_state.drum.hit_detect_us = to_us_since_boot(get_absolute_time());
         }
     }
 
-    input_state.drum.don_left.triggered = m_pads.at(Id::DON_LEFT).getState();
-    input_state.drum.ka_left.triggered = m_pads.at(Id::KA_LEFT).getState();
-    input_state.drum.don_right.triggered = m_pads.at(Id::DON_RIGHT).getState();
-    input_state.drum.ka_right.triggered = m_pads.at(Id::KA_RIGHT).getState();
+    input_state.drum.don_left.triggered = m_pads[Id::DON_LEFT].getState();
+    input_state.drum.ka_left.triggered = m_pads[Id::KA_LEFT].getState();
+    input_state.drum.don_right.triggered = m_pads[Id::DON_RIGHT].getState();
+    input_state.drum.ka_right.triggered = m_pads[Id::KA_RIGHT].getState();
 
     updateRollCounter(input_state);
 }
 
-void Drum::updateAnalogInputState(Utils::InputState &input_state, const std::map<Drum::Id, uint16_t> &raw_values) {
-    struct buffer_entry {
-        uint16_t value;
-        uint32_t timestamp;
-    };
-
-    static std::map<Id, std::deque<buffer_entry>> buffer;
+void DONCON_HOT_FUNC(Drum::updateAnalogInputState)(Utils::InputState &input_state,
+                                                   const ById<uint16_t> &raw_values) {
+    // Static storage since the windows are too large for the stack.
+    static ById<PeakWindow> windows = {};
 
     uint32_t now = to_ms_since_boot(get_absolute_time());
 
-    std::for_each(raw_values.cbegin(), raw_values.cend(), [&](const auto &entry) {
-        const auto &id = entry.first;
-        const auto &raw = entry.second;
-        auto &buf = buffer[id];
-
-        // Clear outdated values, i.e. anything older than debounce_delay to allow for convenient configuration.
-        while (!buf.empty() && (buf.front().timestamp + m_config.debounce_delay_ms) <= now) {
-            buf.pop_front();
-        }
-
-        // Insert current value.
-        buf.push_back({raw, now});
+    // Map 12bit raw value to 16bit
+    const auto raw_to_uint16 = [](uint16_t raw) { return ((raw << 4) & 0xFFF0) | ((raw >> 8) & 0x000F); };
 
-        // Set maximum value for each pads buffer window.
-        const auto get_max = [](const auto &input) {
-            return std::max_element(input.cbegin(), input.cend(),
-                                    [](const auto &a, const auto &b) { return a.value < b.value; })
-                ->value;
-        };
+    for (const auto id : pad_ids) {
+        auto &window = windows[id];
 
-        // Map 12bit raw value to 16bit
-        const auto raw_to_uint16 = [](uint16_t raw) { return ((raw << 4) & 0xFFF0) | ((raw >> 8) & 0x000F); };
+        // Keep anything within debounce_delay to allow for convenient configuration.
+        window.update(raw_values[id], now, m_config.debounce_delay_ms);
 
         switch (id) {
         case Id::DON_LEFT:
-            input_state.drum.don_left.analog = raw_to_uint16(get_max(buf));
+            input_state.drum.don_left.analog = raw_to_uint16(window.getMax());
             break;
         case Id::DON_RIGHT:
-            input_state.drum.don_right.analog = raw_to_uint16(get_max(buf));
+            input_state.drum.don_right.analog = raw_to_uint16(window.getMax());
             break;
         case Id::KA_LEFT:
-            input_state.drum.ka_left.analog = raw_to_uint16(get_max(buf));
+            input_state.drum.ka_left.analog = raw_to_uint16(window.getMax());
             break;
         case Id::KA_RIGHT:
-            input_state.drum.ka_right.analog = raw_to_uint16(get_max(buf));
+            input_state.drum.ka_right.analog = raw_to_uint16(window.getMax());
             break;
         }
-    });
+    }
 }
 
-void Drum::updateInputState(Utils::InputState &input_state) {
+void DONCON_HOT_FUNC(Drum::updateAdcStats)() {
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+    const uint32_t elapsed_us = now - m_adc_stats_start_us;
+
+    if (elapsed_us < 1000000) {
+        return;
+    }
+
+    const auto counters = m_adc->takeCounters();
+    const auto per_second = [&](const uint32_t current, const uint32_t previous) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(current - previous) * 1000000) / elapsed_us);
+    };
+
+    for (size_t idx = 0; idx < counters.conversions.size(); ++idx) {
+        m_adc_stats.conversions_per_s[idx] = per_second(counters.conversions[idx], m_adc_counters.conversions[idx]);
+    }
+    m_adc_stats.irqs_per_s = per_second(counters.irqs, m_adc_counters.irqs);
+    m_adc_stats.irq_load_permille = per_second(counters.irq_busy_us, m_adc_counters.irq_busy_us) / 1000;
+    m_adc_stats.max_cycle_us = counters.max_cycle_us;
+
+    m_adc_counters = counters;
+    m_adc_stats_start_us = now;
+}
+
+void DONCON_HOT_FUNC(Drum::updateInputState)(Utils::InputState &input_state) {
+    updateAdcStats();
+
     const auto raw_values = readInputs();
 
-    input_state.drum.don_left.raw = raw_values.at(Id::DON_LEFT);
-    input_state.drum.don_right.raw = raw_values.at(Id::DON_RIGHT);
-    input_state.drum.ka_left.raw = raw_values.at(Id::KA_LEFT);
-    input_state.drum.ka_right.raw = raw_values.at(Id::KA_RIGHT);
+    input_state.drum.don_left.raw = raw_values[Id::DON_LEFT];
+    input_state.drum.don_right.raw = raw_values[Id::DON_RIGHT];
+    input_state.drum.ka_left.raw = raw_values[Id::KA_LEFT];
+    input_state.drum.ka_right.raw = raw_values[Id::KA_RIGHT];
 
     updateDigitalInputState(input_state, raw_values);
     updateAnalogInputState(input_state, raw_values);
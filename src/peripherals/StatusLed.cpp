@@ -5,7 +5,8 @@
 
 namespace Doncon::Peripherals {
 
-StatusLed::StatusLed(const Config &config) : m_config(config), m_input_state({}), m_player_color(std::nullopt) {
+StatusLed::StatusLed(const Config &config)
+    : m_config(config), m_input_state({}), m_player_color(std::nullopt), m_pixel(std::nullopt) {
     gpio_init(m_config.led_enable_pin);
     gpio_set_dir(m_config.led_enable_pin, GPIO_OUT);
     gpio_put(m_config.led_enable_pin, 1);
@@ -48,19 +49,23 @@ void StatusLed::update() {
         triggered = true;
     }
 
+    uint32_t pixel;
     if (triggered) {
-        ws2812_put_pixel(
-            ws2812_rgb_to_gamma_corrected_u32pixel(static_cast<uint8_t>((float)mixed.r * brightness_factor),
-                                                   static_cast<uint8_t>((float)mixed.g * brightness_factor),
-                                                   static_cast<uint8_t>((float)mixed.b * brightness_factor)));
+        pixel = ws2812_rgb_to_gamma_corrected_u32pixel(static_cast<uint8_t>((float)mixed.r * brightness_factor),
+                                                       static_cast<uint8_t>((float)mixed.g * brightness_factor),
+                                                       static_cast<uint8_t>((float)mixed.b * brightness_factor));
     } else {
         const auto idle_color =
             m_config.enable_player_color ? m_player_color.value_or(m_config.idle_color) : m_config.idle_color;
 
-        ws2812_put_pixel(
-            ws2812_rgb_to_gamma_corrected_u32pixel(static_cast<uint8_t>((idle_color.r) * brightness_factor),
-                                                   static_cast<uint8_t>((idle_color.g) * brightness_factor),
-                                                   static_cast<uint8_t>((idle_color.b) * brightness_factor)));
+        pixel = ws2812_rgb_to_gamma_corrected_u32pixel(static_cast<uint8_t>((idle_color.r) * brightness_factor),
+                                                       static_cast<uint8_t>((idle_color.g) * brightness_factor),
+                                                       static_cast<uint8_t>((idle_color.b) * brightness_factor));
+    }
+
+    if (m_pixel != pixel) {
+        ws2812_put_pixel(pixel);
+        m_pixel = pixel;
     }
 }
 
@@ -1,6 +1,7 @@
 #include "usb/device/hid/keyboard_driver.h"
 
 #include "usb/device/hid/common.h"
+#include "utils/HotPath.h"
 
 #include "tusb.h"
 
@@ -52,7 +53,7 @@ uint8_t const keyboard_desc_cfg[] = {
 
 static hid_keyboard_report_t last_report = {};
 
-bool send_hid_keyboard_report(usb_report_t report) {
+bool DONCON_HOT_FUNC(send_hid_keyboard_report)(usb_report_t report) {
     bool result = false;
 
     if (tud_hid_ready()) {
@@ -1,6 +1,7 @@
 #include "usb/device/hid/ps3_driver.h"
 
 #include "usb/device/hid/common.h"
+#include "utils/HotPath.h"
 
 #include "pico/unique_id.h"
 
@@ -114,7 +115,7 @@ const uint8_t ps3_desc_cfg[] = {
 
 static hid_ps3_report_t last_report = {};
 
-bool send_hid_ps3_report(usb_report_t report) {
+bool DONCON_HOT_FUNC(send_hid_ps3_report)(usb_report_t report) {
     bool result = false;
     if (tud_hid_ready()) {
         result = tud_hid_report(0, report.data, report.size);
@@ -269,4 +270,5 @@ const usbd_driver_t hid_ds3_device_driver = {
     .desc_cfg = ps3_desc_cfg,
     .desc_bos = NULL,
     .send_report = send_hid_ps3_report,
+    .keepalive_ms = 4,
 };
@@ -1,6 +1,7 @@
 #include "usb/device/hid/ps4_driver.h"
 
 #include "usb/device/hid/common.h"
+#include "utils/HotPath.h"
 
 #include "pico/unique_id.h"
 
@@ -326,7 +327,7 @@ static const uint8_t ps4_0x03_report[] = {0x21, 0x27, 0x04, 0xcf, 0x00, 0x2c, 0x
 
 static hid_ps4_report_t last_report = {};
 
-bool send_hid_ps4_report(usb_report_t report) {
+bool DONCON_HOT_FUNC(send_hid_ps4_report)(usb_report_t report) {
     bool result = false;
     if (tud_hid_ready()) {
         result = tud_hid_report(0, report.data, report.size);
@@ -435,6 +436,7 @@ const usbd_driver_t hid_ds4_device_driver = {
     .desc_cfg = ps4_desc_cfg,
     .desc_bos = NULL,
     .send_report = send_hid_ps4_report,
+    .keepalive_ms = 4,
 };
 
 const usbd_driver_t hid_ps4_tatacon_device_driver = {
@@ -444,4 +446,5 @@ const usbd_driver_t hid_ps4_tatacon_device_driver = {
     .desc_cfg = ps4_desc_cfg,
     .desc_bos = NULL,
     .send_report = send_hid_ps4_report,
+    .keepalive_ms = 4,
 };
\ No newline at end of file
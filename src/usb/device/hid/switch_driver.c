@@ -1,6 +1,7 @@
 #include "usb/device/hid/switch_driver.h"
 
 #include "usb/device/hid/common.h"
+#include "utils/HotPath.h"
 
 #include "tusb.h"
 
@@ -95,7 +96,7 @@ const uint8_t switch_desc_cfg[] = {
 
 static hid_switch_report_t last_report = {};
 
-bool send_hid_switch_report(usb_report_t report) {
+bool DONCON_HOT_FUNC(send_hid_switch_report)(usb_report_t report) {
     bool result = false;
     if (tud_hid_ready()) {
         result = tud_hid_report(0, report.data, report.size);
@@ -1,5 +1,7 @@
 #include "usb/device/midi_driver.h"
 
+#include "utils/HotPath.h"
+
 #include "class/midi/midi_device.h"
 
 #include "tusb.h"
@@ -50,7 +52,7 @@ static void set_note(uint8_t channel, bool on, uint8_t pitch, uint8_t velocity)
     write_midi_message(status, pitch, velocity);
 }
 
-bool send_midi_report(usb_report_t report) {
+bool DONCON_HOT_FUNC(send_midi_report)(usb_report_t report) {
     static uint8_t percussion_channel = 9;
 
     midi_report_t *midi_report = (midi_report_t *)report.data;
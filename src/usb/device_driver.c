@@ -5,10 +5,14 @@
 #include "usb/device/hid/ps4_driver.h"
 #include "usb/device/hid/switch_driver.h"
 #include "usb/device/midi_driver.h"
+#include "usb/device/vendor/config_driver.h"
 #include "usb/device/vendor/debug_driver.h"
 #include "usb/device/vendor/xinput_driver.h"
+#include "utils/HotPath.h"
+#include "utils/Trace.h"
 
 #include "bsp/board.h"
+#include "device/dcd.h"
 #include "pico/unique_id.h"
 #include "tusb.h"
 
@@ -16,10 +20,58 @@
 
 #define DESC_STR_MAX (127)
 
+#define USBD_FRAME_INTERVAL_US (1000)
+#define USBD_FRAME_NUMBER_MASK (0x7FF)
+#define USBD_SOF_TIMEOUT_US (3 * USBD_FRAME_INTERVAL_US)
+#define USBD_FALLBACK_INTERVAL_US (900)
+#define USBD_REPORT_MAX_SIZE (128)
+#define USBD_DESC_CFG_MAX_SIZE (256)
+#define USBD_RECONNECT_DELAY_MS (100) // Long enough for the host to notice the disconnect
+
+typedef enum {
+    USBD_SWITCH_IDLE,
+    USBD_SWITCH_UNPLUGGING,   // Waiting for the stack to close the previous driver
+    USBD_SWITCH_DISCONNECTED, // New driver in place, waiting for the reconnect delay
+    USBD_SWITCH_CONNECTING,   // Waiting for the host to configure the device again
+} usbd_switch_state_t;
+
+// The config interface is tried first, it only claims its own interface.
+enum {
+    USBD_APP_DRIVER_CONFIG,
+    USBD_APP_DRIVER_MODE,
+    USBD_APP_DRIVER_COUNT,
+};
+
 static usb_mode_t usbd_mode = USB_MODE_DEBUG;
-static usbd_driver_t usbd_driver = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+static usbd_driver_t usbd_driver = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0};
+static usbd_class_driver_t usbd_app_drivers[USBD_APP_DRIVER_COUNT] = {};
+static bool usbd_config_interface = false;
 static usbd_player_led_cb_t usbd_player_led_cb = NULL;
 
+// Written from the SOF interrupt
+static volatile uint32_t usbd_sof_frame = 0;
+static volatile uint32_t usbd_sof_us = 0;
+static volatile bool usbd_sof_seen = false;
+static volatile uint32_t usbd_report_queued_us = 0;
+static volatile bool usbd_report_pending = false;
+static volatile usbd_sof_age_histogram_t usbd_sof_age_histogram = {};
+
+static uint16_t usbd_sof_lead_us = 250;
+static usb_timing_t usbd_timing = {1, 1};
+static uint32_t usbd_last_sent_frame = UINT32_MAX;
+
+static uint8_t usbd_last_report[USBD_REPORT_MAX_SIZE] = {};
+static uint16_t usbd_last_report_size = 0;
+static uint32_t usbd_last_report_ms = 0;
+static usbd_report_stats_t usbd_report_stats = {};
+static usbd_report_timing_t usbd_report_timing = {};
+
+static usbd_switch_state_t usbd_switch_state = USBD_SWITCH_IDLE;
+static usb_mode_t usbd_switch_mode = USB_MODE_DEBUG;
+static uint32_t usbd_switch_start_us = 0;
+static uint32_t usbd_switch_disconnect_ms = 0;
+static uint32_t usbd_last_switch_us = 0;
+
 #define USBD_SERIAL_STR_SIZE (PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1 + 3)
 static char usbd_serial_str[USBD_SERIAL_STR_SIZE] = {};
 static char usbd_product_str[DESC_STR_MAX] = {};
@@ -30,7 +82,43 @@ char *const usbd_desc_str[] = {
     [USBD_STR_SERIAL] = usbd_serial_str,         //
 };
 
-void usbd_driver_init(usb_mode_t mode) {
+// Called in interrupt context by tinyusb
+static void DONCON_HOT_FUNC(usbd_driver_sof_cb)(uint8_t rhport, uint32_t frame_count) {
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+
+    usbd_sof_frame = frame_count;
+    usbd_sof_us = now;
+    usbd_sof_seen = true;
+
+    if (usbd_report_pending) {
+        const uint32_t age_us = now - usbd_report_queued_us;
+        const uint32_t bucket = age_us / USBD_SOF_AGE_BUCKET_US;
+
+        usbd_sof_age_histogram.buckets[bucket < USBD_SOF_AGE_BUCKET_COUNT ? bucket : USBD_SOF_AGE_BUCKET_COUNT - 1]++;
+        if (age_us > usbd_sof_age_histogram.max_us) {
+            usbd_sof_age_histogram.max_us = age_us;
+        }
+
+        usbd_report_pending = false;
+    }
+
+    if (usbd_driver.app_driver->sof) {
+        usbd_driver.app_driver->sof(rhport, frame_count);
+    }
+}
+
+// Called from tud_task() once a transfer has finished
+static bool DONCON_HOT_FUNC(usbd_driver_xfer_cb)(uint8_t rhport, uint8_t ep_addr, xfer_result_t result,
+                                                 uint32_t xferred_bytes) {
+    if ((ep_addr & TUSB_DIR_IN_MASK) && result == XFER_RESULT_SUCCESS && !usbd_report_timing.completed) {
+        usbd_report_timing.completed_us = to_us_since_boot(get_absolute_time());
+        usbd_report_timing.completed = true;
+    }
+
+    return usbd_driver.app_driver->xfer_cb(rhport, ep_addr, result, xferred_bytes);
+}
+
+static void usbd_driver_select(usb_mode_t mode) {
     usbd_mode = mode;
 
     switch (mode) {
@@ -66,31 +154,188 @@ void usbd_driver_init(usb_mode_t mode) {
         break;
     }
 
+    // Hook into SOF on top of the actual driver to synchronize reports to the host's frames,
+    // and into transfer completion to measure when reports actually reached the host.
+    usbd_class_driver_t *app_driver = &usbd_app_drivers[USBD_APP_DRIVER_MODE];
+    *app_driver = *usbd_driver.app_driver;
+    app_driver->sof = usbd_driver_sof_cb;
+    app_driver->xfer_cb = usbd_driver_xfer_cb;
+
+    // Strings contain the mode, rebuild them on the next request.
+    usbd_serial_str[0] = '\0';
+    usbd_product_str[0] = '\0';
+
+    // Nothing sent so far in this mode.
+    usbd_sof_seen = false;
+    usbd_report_pending = false;
+    usbd_last_sent_frame = UINT32_MAX;
+    usbd_last_report_size = 0;
+    usbd_report_timing = (usbd_report_timing_t){};
+}
+
+void usbd_driver_init(usb_mode_t mode) {
+    usbd_app_drivers[USBD_APP_DRIVER_CONFIG] = config_app_driver;
+    usbd_driver_select(mode);
+
     tud_init(BOARD_TUD_RHPORT);
+    tud_sof_cb_enable(true);
+}
+
+void usbd_driver_switch_mode(usb_mode_t mode) {
+    usbd_switch_mode = mode;
+    usbd_switch_start_us = to_us_since_boot(get_absolute_time());
+
+    // The unplug event makes the stack reset the previous driver and close its endpoints
+    // before it gets replaced.
+    tud_disconnect();
+    dcd_event_bus_signal(BOARD_TUD_RHPORT, DCD_EVENT_UNPLUGGED, false);
+    usbd_switch_state = USBD_SWITCH_UNPLUGGING;
 }
 
-void usbd_driver_task() { tud_task(); }
+uint32_t usbd_driver_get_last_switch_time() { return usbd_last_switch_us; }
+
+void usbd_driver_task() {
+    tud_task();
+
+    switch (usbd_switch_state) {
+    case USBD_SWITCH_DISCONNECTED:
+        if (to_ms_since_boot(get_absolute_time()) - usbd_switch_disconnect_ms >= USBD_RECONNECT_DELAY_MS) {
+            tud_connect();
+            usbd_switch_state = USBD_SWITCH_CONNECTING;
+        }
+        break;
+    case USBD_SWITCH_IDLE:
+    case USBD_SWITCH_UNPLUGGING:
+    case USBD_SWITCH_CONNECTING:
+        break;
+    }
+}
 
 usb_mode_t usbd_driver_get_mode() { return usbd_mode; }
 
-void usbd_driver_send_report(usb_report_t report) {
-    static const uint64_t interval_us = 900;
-    static uint64_t start_us = 0;
+void usbd_driver_set_sof_lead_time(uint16_t lead_us) {
+    usbd_sof_lead_us = lead_us < USBD_FRAME_INTERVAL_US ? lead_us : USBD_FRAME_INTERVAL_US - 1;
+}
+
+void usbd_driver_set_config_interface(bool enable) { usbd_config_interface = enable; }
+
+void usbd_driver_set_timing(usb_timing_t timing) {
+    usbd_timing.interval_ms = timing.interval_ms ? timing.interval_ms : 1;
+    usbd_timing.pacing_frames = timing.pacing_frames;
+}
+
+static bool DONCON_HOT_FUNC(usbd_driver_report_due)(void) {
+    static uint32_t fallback_start_us = 0;
 
-    if (to_us_since_boot(get_absolute_time()) - start_us <= interval_us) {
+    // Unpaced, changes are queued right away and picked up by the host's next poll.
+    if (usbd_timing.pacing_frames == 0) {
+        return true;
+    }
+
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+
+    // Make sure frame number and timestamp belong to the same SOF.
+    uint32_t sof_frame, sof_us;
+    do {
+        sof_frame = usbd_sof_frame;
+        sof_us = usbd_sof_us;
+    } while (sof_frame != usbd_sof_frame);
+
+    if (usbd_sof_seen && (now - sof_us) < USBD_SOF_TIMEOUT_US) {
+        const uint32_t send_offset_us = USBD_FRAME_INTERVAL_US - usbd_sof_lead_us;
+
+        // Send once per pacing interval, as late as possible before the next SOF.
+        if (((sof_frame - usbd_last_sent_frame) & USBD_FRAME_NUMBER_MASK) < usbd_timing.pacing_frames ||
+            (now - sof_us) < send_offset_us) {
+            return false;
+        }
+        usbd_last_sent_frame = sof_frame;
+
+        return true;
+    }
+
+    // No SOF while not configured or suspended, fall back to a free running timer.
+    if (now - fallback_start_us <= usbd_timing.pacing_frames * USBD_FALLBACK_INTERVAL_US) {
+        return false;
+    }
+    fallback_start_us = now;
+
+    return true;
+}
+
+void DONCON_HOT_FUNC(usbd_driver_send_report)(usb_report_t report) {
+    if (!usbd_driver.send_report || usbd_switch_state != USBD_SWITCH_IDLE || !usbd_driver_report_due()) {
+        return;
+    }
+
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+    const bool unchanged = report.size == usbd_last_report_size && report.size <= USBD_REPORT_MAX_SIZE &&
+                           memcmp(report.data, usbd_last_report, report.size) == 0;
+    const bool keepalive = usbd_driver.keepalive_ms && (now - usbd_last_report_ms) >= usbd_driver.keepalive_ms;
+
+    if (unchanged && !keepalive) {
+        usbd_report_stats.unchanged++;
         return;
     }
-    start_us += interval_us;
 
     if (tud_suspended()) {
         tud_remote_wakeup();
     }
 
-    if (usbd_driver.send_report) {
-        usbd_driver.send_report(report);
+    TRACE_BEGIN(TRACE_USB_SEND, report.size);
+    const bool queued = usbd_driver.send_report(report);
+    TRACE_END(TRACE_USB_SEND, report.size);
+
+    if (!queued) {
+        usbd_report_stats.failed++;
+        return;
+    }
+
+    usbd_report_queued_us = to_us_since_boot(get_absolute_time());
+    usbd_report_pending = true;
+
+    if (!unchanged) {
+        usbd_report_timing.queued_us = usbd_report_queued_us;
+        usbd_report_timing.completed = false;
+    }
+
+    // Only remember reports which actually went out, so failed ones are retried.
+    if (report.size <= USBD_REPORT_MAX_SIZE) {
+        memcpy(usbd_last_report, report.data, report.size);
+        usbd_last_report_size = report.size;
+    } else {
+        usbd_last_report_size = 0;
+    }
+    usbd_last_report_ms = now;
+
+    if (unchanged) {
+        usbd_report_stats.keepalive++;
+    } else {
+        usbd_report_stats.sent++;
     }
 }
 
+void usbd_driver_get_report_stats(usbd_report_stats_t *stats) { *stats = usbd_report_stats; }
+
+void usbd_driver_get_report_timing(usbd_report_timing_t *timing) { *timing = usbd_report_timing; }
+
+void usbd_driver_get_sof_age_histogram(usbd_sof_age_histogram_t *histogram, bool reset) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+
+    for (size_t i = 0; i < USBD_SOF_AGE_BUCKET_COUNT; ++i) {
+        histogram->buckets[i] = usbd_sof_age_histogram.buckets[i];
+        if (reset) {
+            usbd_sof_age_histogram.buckets[i] = 0;
+        }
+    }
+    histogram->max_us = usbd_sof_age_histogram.max_us;
+    if (reset) {
+        usbd_sof_age_histogram.max_us = 0;
+    }
+
+    restore_interrupts(interrupts);
+}
+
 void usbd_driver_set_player_led_cb(usbd_player_led_cb_t cb) { usbd_player_led_cb = cb; };
 usbd_player_led_cb_t usbd_driver_get_player_led_cb() { return usbd_player_led_cb; };
 
@@ -99,7 +344,29 @@ const uint8_t *tud_descriptor_device_cb(void) { return (const uint8_t *)usbd_dri
 const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
     (void)index;
 
-    return usbd_driver.desc_cfg;
+    static uint8_t desc_cfg[USBD_DESC_CFG_MAX_SIZE];
+
+    const uint16_t total_len = tu_le16toh(((const tusb_desc_configuration_t *)usbd_driver.desc_cfg)->wTotalLength);
+    if (total_len > sizeof(desc_cfg)) {
+        return usbd_driver.desc_cfg;
+    }
+
+    // Patch the polling interval of all interrupt IN endpoints into a copy of the driver's descriptor.
+    memcpy(desc_cfg, usbd_driver.desc_cfg, total_len);
+    for (uint16_t offset = 0; offset < total_len && desc_cfg[offset]; offset += desc_cfg[offset]) {
+        tusb_desc_endpoint_t *desc_ep = (tusb_desc_endpoint_t *)&desc_cfg[offset];
+
+        if (desc_ep->bDescriptorType == TUSB_DESC_ENDPOINT && desc_ep->bmAttributes.xfer == TUSB_XFER_INTERRUPT &&
+            tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+            desc_ep->bInterval = usbd_timing.interval_ms;
+        }
+    }
+
+    if (usbd_config_interface) {
+        config_driver_append_descriptor(desc_cfg, sizeof(desc_cfg));
+    }
+
+    return desc_cfg;
 }
 
 const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
@@ -147,6 +414,29 @@ uint8_t const *tud_descriptor_bos_cb(void) { return usbd_driver.desc_bos; }
 
 // Implement callback to add our custom driver
 const usbd_class_driver_t *usbd_app_driver_get_cb(uint8_t *driver_count) {
-    *driver_count = 1;
-    return usbd_driver.app_driver;
+    *driver_count = USBD_APP_DRIVER_COUNT;
+    return usbd_app_drivers;
+}
+
+// SOF interrupts might get disabled on bus reset, make sure they are active once configured.
+void tud_mount_cb(void) {
+    tud_sof_cb_enable(true);
+
+    if (usbd_switch_state == USBD_SWITCH_CONNECTING) {
+        usbd_last_switch_us = to_us_since_boot(get_absolute_time()) - usbd_switch_start_us;
+        usbd_switch_state = USBD_SWITCH_IDLE;
+    }
+}
+
+void tud_umount_cb(void) {
+    if (usbd_switch_state == USBD_SWITCH_UNPLUGGING) {
+        // The stack only initializes drivers in tud_init().
+        usbd_driver_select(usbd_switch_mode);
+        if (usbd_app_drivers[USBD_APP_DRIVER_MODE].init) {
+            usbd_app_drivers[USBD_APP_DRIVER_MODE].init();
+        }
+
+        usbd_switch_disconnect_ms = to_ms_since_boot(get_absolute_time());
+        usbd_switch_state = USBD_SWITCH_DISCONNECTED;
+    }
 }
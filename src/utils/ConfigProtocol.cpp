@@ -0,0 +1,172 @@
+#include "utils/ConfigProtocol.h"
+
+#include "usb/device/vendor/config_driver.h"
+
+#include "pico/time.h"
+
+#include <array>
+#include <string.h>
+
+namespace Doncon::Utils {
+
+namespace {
+
+ConfigProtocol *registered_protocol = nullptr;
+
+} // namespace
+
+static_assert(sizeof(ConfigProtocol::StreamFrame) <= CONFIG_EP_BUFSIZE);
+
+ConfigProtocol::ConfigProtocol(std::shared_ptr<SettingsStore> settings_store)
+    : m_store(settings_store), m_changed(false), m_commit_requested(false), m_sequence(0) {
+
+    registered_protocol = this;
+    config_driver_set_callbacks({handleGet, handleSet, handleCommit});
+}
+
+uint16_t ConfigProtocol::handleGet(uint8_t field, uint8_t index, uint8_t *data, uint16_t max_length) {
+    auto &store = *registered_protocol->m_store;
+
+    const auto put = [&](const auto &value) -> uint16_t {
+        if (sizeof(value) > max_length) {
+            return 0;
+        }
+        memcpy(data, &value, sizeof(value));
+        return sizeof(value);
+    };
+
+    switch (static_cast<Field>(field)) {
+    case Field::ActiveProfile:
+        return put(store.getActiveProfile());
+    case Field::UsbMode:
+        return put(static_cast<uint8_t>(store.getUsbMode()));
+    case Field::TriggerThresholds:
+        return put(store.getTriggerThresholds());
+    case Field::LedBrightness:
+        return put(store.getLedBrightness());
+    case Field::LedEnablePlayerColor:
+        return put(static_cast<uint8_t>(store.getLedEnablePlayerColor()));
+    case Field::DebounceDelay:
+        return put(store.getDebounceDelay());
+    case Field::SocdMode:
+        return put(static_cast<uint8_t>(store.getSocdMode()));
+    case Field::UsbTiming:
+        if (index < USB_MODE_COUNT) {
+            return put(store.getUsbTiming(static_cast<usb_mode_t>(index)));
+        }
+        break;
+    }
+
+    return 0;
+}
+
+bool ConfigProtocol::handleSet(uint8_t field, uint8_t index, const uint8_t *data, uint16_t length) {
+    auto &protocol = *registered_protocol;
+    auto &store = *protocol.m_store;
+
+    const auto get = [&](auto &value) {
+        if (length != sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, data, sizeof(value));
+        return true;
+    };
+
+    bool valid = false;
+    switch (static_cast<Field>(field)) {
+    case Field::ActiveProfile: {
+        uint8_t profile;
+        valid = get(profile) && profile < SettingsStore::profile_count;
+        if (valid) {
+            store.setActiveProfile(profile);
+        }
+    } break;
+    case Field::UsbMode: {
+        uint8_t mode;
+        valid = get(mode) && mode < USB_MODE_COUNT;
+        if (valid) {
+            store.setUsbMode(static_cast<usb_mode_t>(mode));
+        }
+    } break;
+    case Field::TriggerThresholds: {
+        Peripherals::Drum::Config::Thresholds thresholds;
+        valid = get(thresholds);
+        if (valid) {
+            store.setTriggerThresholds(thresholds);
+        }
+    } break;
+    case Field::LedBrightness: {
+        uint8_t brightness;
+        valid = get(brightness);
+        if (valid) {
+            store.setLedBrightness(brightness);
+        }
+    } break;
+    case Field::LedEnablePlayerColor: {
+        uint8_t enable;
+        valid = get(enable);
+        if (valid) {
+            store.setLedEnablePlayerColor(enable != 0);
+        }
+    } break;
+    case Field::DebounceDelay: {
+        // Same limit as the menu, the drum's peak window is sized for it.
+        uint16_t delay;
+        valid = get(delay) && delay <= UINT8_MAX;
+        if (valid) {
+            store.setDebounceDelay(delay);
+        }
+    } break;
+    case Field::SocdMode: {
+        uint8_t mode;
+        valid = get(mode) && mode <= static_cast<uint8_t>(Peripherals::Buttons::SocdMode::UpPriority);
+        if (valid) {
+            store.setSocdMode(static_cast<Peripherals::Buttons::SocdMode>(mode));
+        }
+    } break;
+    case Field::UsbTiming: {
+        usb_timing_t timing;
+        valid = index < USB_MODE_COUNT && get(timing);
+        if (valid) {
+            store.setUsbTiming(static_cast<usb_mode_t>(index), timing);
+        }
+    } break;
+    }
+
+    protocol.m_changed = protocol.m_changed || valid;
+
+    return valid;
+}
+
+void ConfigProtocol::handleCommit() { registered_protocol->m_commit_requested = true; }
+
+void ConfigProtocol::stream(const InputState::Drum &drum) {
+    const std::array<const InputState::Drum::Pad *, 4> pads = {&drum.don_left, &drum.ka_left, &drum.don_right,
+                                                              &drum.ka_right};
+
+    StreamFrame frame = {m_sequence, 0, time_us_32(), {}};
+    for (size_t idx = 0; idx < pads.size(); ++idx) {
+        frame.triggered |= (pads[idx]->triggered ? 1 : 0) << idx;
+        frame.pads[idx] = {pads[idx]->raw, pads[idx]->analog};
+    }
+
+    if (config_driver_stream(reinterpret_cast<const uint8_t *>(&frame), sizeof(frame))) {
+        m_sequence++;
+    }
+}
+
+bool ConfigProtocol::takeChanged() {
+    const bool changed = m_changed;
+    m_changed = false;
+
+    return changed;
+}
+
+bool ConfigProtocol::takeCommitRequest() {
+    const bool requested = m_commit_requested;
+    m_commit_requested = false;
+
+    return requested;
+}
+
+} // namespace Doncon::Utils
@@ -0,0 +1,23 @@
+#include "utils/Crc32.h"
+
+#include <array>
+
+namespace Doncon::Utils {
+
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc) {
+    // Nibble-wise lookup, small enough to not bother about flash or RAM usage.
+    static const std::array<uint32_t, 16> table = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+
+    crc = ~crc;
+    for (size_t idx = 0; idx < length; ++idx) {
+        crc = table[(crc ^ data[idx]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (data[idx] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+
+    return ~crc;
+}
+
+} // namespace Doncon::Utils
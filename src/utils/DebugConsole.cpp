@@ -0,0 +1,362 @@
+#include "utils/DebugConsole.h"
+
+#include "peripherals/Controller.h"
+#include "peripherals/Display.h"
+#include "peripherals/StatusLed.h"
+#include "usb/device_driver.h"
+#include "utils/HeapTracker.h"
+#include "utils/MemoryMonitor.h"
+#include "utils/Menu.h"
+#include "utils/Trace.h"
+
+#include "pico/stdlib.h"
+
+#include <array>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string>
+
+namespace Doncon::Utils {
+
+namespace {
+
+void printSchedulerReport(const Scheduler::Report &report) {
+    printf("Core1 tasks:\n");
+    printf("%-12s %9s %9s %10s %9s %9s %9s %9s\n", "name", "period", "deadline", "runs", "overruns", "exec",
+           "exec_max", "late_max");
+
+    for (uint8_t idx = 0; idx < report.task_count; ++idx) {
+        const auto &task = report.tasks[idx];
+        printf("%-12s %7" PRIu32 "us %7" PRIu32 "us %10" PRIu32 " %9" PRIu32 " %7" PRIu32 "us %7" PRIu32 "us %7" PRIu32
+               "us\n",
+               task.name, task.period_us, task.deadline_us, task.runs, task.overruns, task.last_exec_us,
+               task.max_exec_us, task.max_latency_us);
+    }
+}
+
+void printSofAgeHistogram() {
+    usbd_sof_age_histogram_t histogram;
+    usbd_driver_get_sof_age_histogram(&histogram, true);
+
+    uint32_t total = 0;
+    for (const auto count : histogram.buckets) {
+        total += count;
+    }
+
+    printf("Report age at SOF (%" PRIu32 " reports, max %" PRIu32 "us):\n", total, histogram.max_us);
+    for (uint32_t idx = 0; idx < USBD_SOF_AGE_BUCKET_COUNT; ++idx) {
+        const uint32_t from_us = idx * USBD_SOF_AGE_BUCKET_US;
+        const auto count = histogram.buckets[idx];
+        const auto bar = std::string(total ? (static_cast<uint64_t>(count) * 40) / total : 0, '#');
+
+        if (idx < USBD_SOF_AGE_BUCKET_COUNT - 1) {
+            printf("%4" PRIu32 "-%4" PRIu32 "us %10" PRIu32 " %s\n", from_us, from_us + USBD_SOF_AGE_BUCKET_US - 1,
+                   count, bar.c_str());
+        } else {
+            printf("   >=%4" PRIu32 "us %10" PRIu32 " %s\n", from_us, count, bar.c_str());
+        }
+    }
+}
+
+void printReportStats(const InputState::ReportStats &encode_stats) {
+    usbd_report_stats_t send_stats;
+    usbd_driver_get_report_stats(&send_stats);
+
+    printf("Reports encoded: %" PRIu32 ", reused: %" PRIu32 "\n", encode_stats.encoded, encode_stats.skipped);
+    printf("Reports sent: %" PRIu32 ", keep-alive: %" PRIu32 ", unchanged: %" PRIu32 ", failed: %" PRIu32 "\n",
+           send_stats.sent, send_stats.keepalive, send_stats.unchanged, send_stats.failed);
+    printf("Last mode switch: %" PRIu32 " us until configured\n", usbd_driver_get_last_switch_time());
+}
+
+void printLatencyReport(const LatencyTracker::Report &report) {
+    static const char *span_names[LatencyTracker::span_count] = {
+        "sample>detect", "detect>encode", "encode>queue", "queue>done", "total",
+    };
+
+    printf("Hit latency (%" PRIu32 " dropped):\n", report.dropped);
+    printf("%-14s %10s %9s %9s %9s\n", "stage", "count", "min", "avg", "max");
+    for (size_t idx = 0; idx < LatencyTracker::span_count; ++idx) {
+        const auto &span = report.spans[idx];
+        if (span.count == 0) {
+            printf("%-14s %10s\n", span_names[idx], "-");
+            continue;
+        }
+        printf("%-14s %10" PRIu32 " %7" PRIu32 "us %7" PRIu32 "us %7" PRIu32 "us\n", span_names[idx], span.count,
+               span.min_us, static_cast<uint32_t>(span.sum_us / span.count), span.max_us);
+    }
+
+    const auto &total = report.spans[static_cast<size_t>(LatencyTracker::Span::Total)];
+    for (uint32_t idx = 0; idx < LatencyTracker::bucket_count; ++idx) {
+        const uint32_t from_us = idx * LatencyTracker::bucket_us;
+        const auto count = total.buckets[idx];
+        const auto bar = std::string(total.count ? (static_cast<uint64_t>(count) * 40) / total.count : 0, '#');
+
+        if (idx < LatencyTracker::bucket_count - 1) {
+            printf("%4" PRIu32 "-%4" PRIu32 "us %10" PRIu32 " %s\n", from_us,
+                   from_us + LatencyTracker::bucket_us - 1, count, bar.c_str());
+        } else {
+            printf("   >=%4" PRIu32 "us %10" PRIu32 " %s\n", from_us, count, bar.c_str());
+        }
+    }
+}
+
+void printLoopReports(const LoopProfiler::Report &core0, const LoopProfiler::Report &core1) {
+    const std::array<const LoopProfiler::Report *, 2> reports = {&core0, &core1};
+
+    printf("Loop timing:\n");
+    printf("%-6s %10s %9s %9s %9s %9s %9s\n", "core", "iter", "rate", "min", "avg", "max", "jitter");
+    for (uint8_t core = 0; core < reports.size(); ++core) {
+        const auto &report = *reports[core];
+        if (report.iterations == 0) {
+            printf("core%-2u %10s\n", core, "-");
+            continue;
+        }
+        printf("core%-2u %10" PRIu32 " %7" PRIu32 "/s %7" PRIu32 "us %7" PRIu32 "us %7" PRIu32 "us %7" PRIu32 "us\n",
+               core, report.iterations, static_cast<uint32_t>((report.iterations * 1000000ULL) / report.sum_us),
+               report.min_us, static_cast<uint32_t>(report.sum_us / report.iterations), report.max_us,
+               report.max_jitter_us);
+    }
+
+    const auto printHistogram = [](const std::array<uint32_t, LoopProfiler::bucket_count> &buckets,
+                                   const uint32_t total) {
+        for (uint32_t idx = 0; idx < LoopProfiler::bucket_count; ++idx) {
+            const auto count = buckets[idx];
+            const auto bar = std::string(total ? (static_cast<uint64_t>(count) * 40) / total : 0, '#');
+
+            if (idx < LoopProfiler::bucket_count - 1) {
+                printf("%6" PRIu32 "us %10" PRIu32 " %s\n", idx ? (UINT32_C(1) << idx) : 0, count, bar.c_str());
+            } else {
+                printf(">=%4" PRIu32 "us %10" PRIu32 " %s\n", UINT32_C(1) << idx, count, bar.c_str());
+            }
+        }
+    };
+
+    for (uint8_t core = 0; core < reports.size(); ++core) {
+        const auto &report = *reports[core];
+
+        printf("Core%u iteration times:\n", core);
+        printHistogram(report.buckets, report.iterations);
+        printf("Core%u jitter:\n", core);
+        printHistogram(report.jitter_buckets, report.iterations);
+    }
+}
+
+void printAdcStats(const Peripherals::Drum::AdcStats &stats) {
+    printf("ADC conversions per second:");
+    for (size_t idx = 0; idx < stats.conversions_per_s.size(); ++idx) {
+        printf(" ch%u %" PRIu32, static_cast<unsigned>(idx), stats.conversions_per_s[idx]);
+    }
+    printf("\n");
+    printf("ADC interrupts per second: %" PRIu32 ", load: %" PRIu32 ".%" PRIu32 "%%, max cycle time: %" PRIu32 "us\n",
+           stats.irqs_per_s, stats.irq_load_permille / 10, stats.irq_load_permille % 10, stats.max_cycle_us);
+}
+
+void printHeapReport(const HeapTracker::Report &report) {
+    printf("Heap: %" PRIu32 " bytes in use by C++, peak %" PRIu32 ", startup peak %" PRIu32 "\n", report.current_bytes,
+           report.peak_bytes, report.startup_peak_bytes);
+    printf("Heap: %" PRIu32 " of %" PRIu32 " bytes used in total\n", report.heap_used, report.heap_size);
+
+    printf("%-6s %-10s %10s %10s %10s\n", "core", "region", "allocs", "frees", "bytes");
+    for (uint8_t core = 0; core < HeapTracker::core_count; ++core) {
+        for (uint8_t idx = 0; idx < HeapTracker::region_count; ++idx) {
+            const auto &counters = report.counters[core][idx];
+            if (counters.allocations == 0 && counters.frees == 0) {
+                continue;
+            }
+            printf("core%-2u %-10s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n", core,
+                   HeapTracker::getRegionName(static_cast<HeapTracker::Region>(idx)),
+                   counters.allocations, counters.frees, counters.allocated_bytes);
+        }
+    }
+}
+
+void printMemoryReport(const MemoryMonitor::Report &report, const HeapTracker::Report &heap) {
+    printf("Stacks:\n");
+    printf("%-6s %8s %8s %8s\n", "core", "size", "used", "free");
+    for (uint8_t core = 0; core < report.stacks.size(); ++core) {
+        const auto &stack = report.stacks[core];
+        if (stack.overflowed) {
+            printf("core%-2u %8" PRIu32 " %8s %8s\n", core, stack.size, "overflow", "-");
+        } else {
+            printf("core%-2u %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", core, stack.size, stack.used,
+                   stack.size - stack.used);
+        }
+    }
+
+    printf("SRAM, %" PRIu32 " bytes in total:\n", static_cast<uint32_t>(SRAM_END - SRAM_BASE));
+    printf("%8" PRIu32 "  data, including code in SRAM\n", report.data_bytes);
+    printf("%8" PRIu32 "  bss\n", report.bss_bytes);
+    printf("%8" PRIu32 "  heap, %" PRIu32 " used\n", report.heap_size, heap.heap_used);
+    printf("%8" PRIu32 "  stacks\n", report.stacks[0].size + report.stacks[1].size);
+
+    struct Usage {
+        const char *name;
+        const char *location;
+        size_t bytes;
+    };
+
+    const std::array<Usage, 15> usages = {{
+        {"Drum", "core0 stack", sizeof(Peripherals::Drum)},
+        {"InputState", "core0 stack", sizeof(InputState)},
+        {"Menu", "core0 stack", sizeof(Menu)},
+        {"DebugConsole", "core0 stack", sizeof(DebugConsole)},
+        {"LatencyTracker", "core0 stack", sizeof(LatencyTracker)},
+        {"LoopProfiler", "core0 stack", sizeof(LoopProfiler)},
+        {"SettingsStore", "heap", sizeof(SettingsStore)},
+        {"Buttons", "core1 stack", sizeof(Peripherals::Buttons)},
+        {"StatusLed", "core1 stack", sizeof(Peripherals::StatusLed)},
+        {"Display", "core1 stack", sizeof(Peripherals::Display)},
+        {"InputState", "core1 stack", sizeof(InputState)},
+        {"Scheduler", "core1 stack", sizeof(Scheduler)},
+        {"LoopProfiler", "core1 stack", sizeof(LoopProfiler)},
+        {"Menu message", "core1 stack", sizeof(Menu::State)},
+        {"Trace buffers", "bss", DONCON_TRACE ? sizeof(trace_entry_t) * DONCON_TRACE_BUFFER_SIZE * NUM_CORES : 0},
+    }};
+
+    printf("Subsystems:\n");
+    for (const auto &usage : usages) {
+        printf("%8u  %-20s %s\n", static_cast<unsigned>(usage.bytes), usage.name, usage.location);
+    }
+}
+
+void printCommitStats(const SettingsStore::CommitStats &stats, const bool pending) {
+    printf("Settings commits: %" PRIu32 ", erases: %" PRIu32 ", programs: %" PRIu32 "%s\n", stats.commits,
+           stats.erases, stats.programs, pending ? ", pending" : "");
+    printf("Interrupts disabled: last erase %" PRIu32 "us, last program %" PRIu32 "us, max %" PRIu32
+           "us, %" PRIu32 " over budget\n",
+           stats.last_erase_us, stats.last_program_us, stats.max_blocking_us, stats.over_budget);
+    printf("Journal: sector %u, next page %u, sequence %" PRIu32 "\n", stats.sector, stats.next_page, stats.sequence);
+}
+
+void printSettingsExport(const SettingsStore &settings_store) {
+    std::array<uint8_t, SettingsStore::blob_max_size> blob;
+    const auto length = settings_store.exportSettings(blob.data());
+
+    printf("# settings ");
+    for (size_t idx = 0; idx < length; ++idx) {
+        printf("%02x", blob[idx]);
+    }
+    printf("\n");
+}
+
+void printTrace(const Scheduler::Report &scheduler_report) {
+#if DONCON_TRACE
+    static trace_entry_t entries[DONCON_TRACE_BUFFER_SIZE];
+
+    // Stop recording so the buffers don't wrap while they are being printed.
+    trace_set_enabled(false);
+
+    printf("# trace begin\n");
+    for (uint8_t idx = 0; idx < TRACE_EVENT_COUNT; ++idx) {
+        printf("N %u %s\n", idx, trace_event_names[idx]);
+    }
+    for (uint8_t idx = 0; idx < scheduler_report.task_count; ++idx) {
+        printf("T %u %s\n", idx, scheduler_report.tasks[idx].name);
+    }
+    for (uint8_t core = 0; core < NUM_CORES; ++core) {
+        const auto count = trace_read(core, entries, DONCON_TRACE_BUFFER_SIZE);
+        for (uint32_t idx = 0; idx < count; ++idx) {
+            printf("E %u %" PRIu32 " %u %c %u\n", core, entries[idx].timestamp_us, entries[idx].event_id,
+                   entries[idx].phase, entries[idx].arg);
+        }
+    }
+    printf("# trace end\n");
+
+    trace_set_enabled(true);
+#else
+    (void)scheduler_report;
+    printf("Tracing is disabled, build with -DDONCON_TRACE=ON to enable it.\n");
+#endif
+}
+
+} // namespace
+
+DebugConsole::DebugConsole(std::shared_ptr<SettingsStore> settings_store, Peripherals::Drum &drum,
+                           InputState &input_state, LatencyTracker &latency_tracker, LoopProfiler &loop_profiler,
+                           const Queues &queues)
+    : m_store(settings_store), m_drum(drum), m_input_state(input_state), m_latency_tracker(latency_tracker),
+      m_loop_profiler(loop_profiler), m_queues(queues), m_scheduler_report({}), m_core1_loop_report({}),
+      m_imported(false) {}
+
+void DebugConsole::update() {
+    queue_try_remove(m_queues.scheduler_report, &m_scheduler_report);
+    queue_try_remove(m_queues.core1_loop_report, &m_core1_loop_report);
+
+    if (m_settings_import.active()) {
+        receiveImport();
+        return;
+    }
+
+    processCommand(getchar_timeout_us(0));
+}
+
+void DebugConsole::receiveImport() {
+    switch (m_settings_import.receive()) {
+    case SettingsImport::Result::Pending:
+        break;
+    case SettingsImport::Result::Complete:
+        // All settings are written in a single flash page, so an import is never applied partially.
+        if (m_settings_import.apply(*m_store)) {
+            printf("# import ok\n");
+            m_imported = true;
+        } else {
+            printf("# import failed\n");
+        }
+        break;
+    case SettingsImport::Result::Failed:
+        printf("# import failed\n");
+        break;
+    }
+}
+
+void DebugConsole::processCommand(int command) {
+    switch (command) {
+    case 's':
+        printSchedulerReport(m_scheduler_report);
+        break;
+    case 'u':
+        printSofAgeHistogram();
+        break;
+    case 'r':
+        printReportStats(m_input_state.getReportStats());
+        break;
+    case 'l':
+        printLatencyReport(m_latency_tracker.getReport());
+        break;
+    case 't':
+        printTrace(m_scheduler_report);
+        break;
+    case 'p':
+        printLoopReports(m_loop_profiler.getReport(), m_core1_loop_report);
+        break;
+    case 'a':
+        printAdcStats(m_drum.getAdcStats());
+        break;
+    case 'h':
+        printHeapReport(HeapTracker::getReport());
+        break;
+    case 'f':
+        printCommitStats(m_store->getCommitStats(), m_store->commitPending());
+        break;
+    case 'm':
+        printMemoryReport(MemoryMonitor::getReport(), HeapTracker::getReport());
+        break;
+    case 'e':
+        printSettingsExport(*m_store);
+        break;
+    case 'i':
+        m_settings_import.start();
+        break;
+    default:
+        break;
+    }
+}
+
+bool DebugConsole::takeImported() {
+    const bool imported = m_imported;
+    m_imported = false;
+
+    return imported;
+}
+
+} // namespace Doncon::Utils
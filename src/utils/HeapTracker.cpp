@@ -0,0 +1,175 @@
+#include "utils/HeapTracker.h"
+
+#include "hardware/sync.h"
+#include "pico/platform.h"
+
+#include <malloc.h>
+
+// C++ allocations are intercepted by wrapping the operators at link time, see CMakeLists.txt. Plain
+// malloc() is already wrapped by the SDK and can't be wrapped again, so only allocations from C code
+// like the USB stack are not counted. Every allocation gets a header to remember its size.
+//
+// All six operators come from the SDK's pico_cxx_options new_delete.cpp, which implements each of them
+// directly on malloc()/free(). So the array and sized variants never reach the scalar ones and every
+// allocation passes exactly one wrapper. libstdc++'s own operators would chain new[] to new and sized
+// delete to delete, CMakeLists.txt refuses configurations that would link those.
+
+extern "C" {
+void *__real__Znwj(size_t size);
+void *__real__Znaj(size_t size);
+void __real__ZdlPv(void *ptr);
+void __real__ZdaPv(void *ptr);
+void __real__ZdlPvj(void *ptr, size_t size);
+void __real__ZdaPvj(void *ptr, size_t size);
+
+extern char end;
+extern char __StackLimit; // Historically named, this is the upper limit of the heap
+}
+
+namespace Doncon::Utils {
+
+namespace {
+
+const size_t header_size = 8; // Keeps the 8 byte alignment of the allocator
+
+HeapTracker::Report report = {};
+volatile HeapTracker::Region current_region[HeapTracker::core_count] = {HeapTracker::Region::Startup,
+                                                                        HeapTracker::Region::Startup};
+
+spin_lock_t *getLock() { return spin_lock_instance(PICO_SPINLOCK_ID_OS2); }
+
+bool isGuarded(const HeapTracker::Region region) {
+    switch (region) {
+    case HeapTracker::Region::Drum:
+    case HeapTracker::Region::Usb:
+    case HeapTracker::Region::Core1Io:
+    case HeapTracker::Region::Display:
+        return true;
+    case HeapTracker::Region::Startup:
+    case HeapTracker::Region::Menu:
+    case HeapTracker::Region::Debug:
+        break;
+    }
+    return false;
+}
+
+void *trackAllocation(void *ptr, const size_t size) {
+    if (!ptr) {
+        return nullptr;
+    }
+
+    const auto core = get_core_num();
+    const auto region = current_region[core];
+
+    if (DONCON_HEAP_GUARD && isGuarded(region)) {
+        panic("Heap allocation of %u bytes in region %s on core%u", static_cast<unsigned>(size),
+              HeapTracker::getRegionName(region), core);
+    }
+
+    *static_cast<uint32_t *>(ptr) = size;
+
+    const auto irq_state = spin_lock_blocking(getLock());
+
+    auto &counters = report.counters[core][static_cast<size_t>(region)];
+    counters.allocations++;
+    counters.allocated_bytes += size;
+
+    report.current_bytes += size;
+    if (report.current_bytes > report.peak_bytes) {
+        report.peak_bytes = report.current_bytes;
+    }
+
+    spin_unlock(getLock(), irq_state);
+
+    return static_cast<uint8_t *>(ptr) + header_size;
+}
+
+void *trackFree(void *ptr) {
+    uint8_t *header = static_cast<uint8_t *>(ptr) - header_size;
+
+    const auto core = get_core_num();
+    const auto region = current_region[core];
+
+    const auto irq_state = spin_lock_blocking(getLock());
+
+    report.counters[core][static_cast<size_t>(region)].frees++;
+    report.current_bytes -= *reinterpret_cast<uint32_t *>(header);
+
+    spin_unlock(getLock(), irq_state);
+
+    return header;
+}
+
+} // namespace
+
+const char *HeapTracker::getRegionName(Region region) {
+    switch (region) {
+    case Region::Startup:
+        return "startup";
+    case Region::Drum:
+        return "drum";
+    case Region::Usb:
+        return "usb";
+    case Region::Menu:
+        return "menu";
+    case Region::Debug:
+        return "debug";
+    case Region::Core1Io:
+        return "core1_io";
+    case Region::Display:
+        return "display";
+    }
+    return "?";
+}
+
+void HeapTracker::setRegion(Region region) { current_region[get_core_num()] = region; }
+
+void HeapTracker::markStartupComplete() {
+    const auto irq_state = spin_lock_blocking(getLock());
+    report.startup_peak_bytes = report.peak_bytes;
+    spin_unlock(getLock(), irq_state);
+}
+
+HeapTracker::Report HeapTracker::getReport() {
+    const auto irq_state = spin_lock_blocking(getLock());
+    auto result = report;
+    spin_unlock(getLock(), irq_state);
+
+    const auto info = mallinfo();
+    result.heap_size = &__StackLimit - &end;
+    result.heap_used = info.uordblks;
+
+    return result;
+}
+
+} // namespace Doncon::Utils
+
+using Doncon::Utils::header_size;
+using Doncon::Utils::trackAllocation;
+using Doncon::Utils::trackFree;
+
+extern "C" {
+void *__wrap__Znwj(size_t size) { return trackAllocation(__real__Znwj(size + header_size), size); }
+void *__wrap__Znaj(size_t size) { return trackAllocation(__real__Znaj(size + header_size), size); }
+
+void __wrap__ZdlPv(void *ptr) {
+    if (ptr) {
+        __real__ZdlPv(trackFree(ptr));
+    }
+}
+void __wrap__ZdaPv(void *ptr) {
+    if (ptr) {
+        __real__ZdaPv(trackFree(ptr));
+    }
+}
+void __wrap__ZdlPvj(void *ptr, size_t size) {
+    if (ptr) {
+        __real__ZdlPvj(trackFree(ptr), size + header_size);
+    }
+}
+void __wrap__ZdaPvj(void *ptr, size_t size) {
+    if (ptr) {
+        __real__ZdaPvj(trackFree(ptr), size + header_size);
+    }
+}
+}
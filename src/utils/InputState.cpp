@@ -1,19 +1,150 @@
 #include "utils/InputState.h"
 
+#include "utils/HotPath.h"
+
 #include <iomanip>
 #include <sstream>
 
 namespace Doncon::Utils {
 
 InputState::InputState()
-    : drum({{false, 0, 0}, {false, 0, 0}, {false, 0, 0}, {false, 0, 0}, 0, 0}),
+    : drum({{false, 0, 0}, {false, 0, 0}, {false, 0, 0}, {false, 0, 0}, 0, 0, 0, 0}),
       controller(
           {{false, false, false, false}, {false, false, false, false, false, false, false, false, false, false}}),
       m_switch_report({}), m_ps3_report({}), m_ps4_report({}), m_keyboard_report({}),
       m_xinput_report({0x00, sizeof(xinput_report_t), 0, 0, 0, 0, 0, 0, 0, 0, {}}),
-      m_midi_report({{false, false, false, false}, {0, 0, 0, 0}}) {}
+      m_midi_report({{false, false, false, false}, {0, 0, 0, 0}}), m_last_mode(std::nullopt), m_last_digital_state(0),
+      m_last_analog_state({}), m_last_report_size(0), m_last_encode_us(0), m_report_stats({0, 0}) {
+
+    // Constant parts of the reports only need to be set once.
+    m_switch_report.lx = 0x80;
+    m_switch_report.ly = 0x80;
+    m_switch_report.rx = 0x80;
+    m_switch_report.ry = 0x80;
+
+    m_ps3_report.report_id = 0x01;
+    m_ps3_report.lx = 0x80;
+    m_ps3_report.ly = 0x80;
+    m_ps3_report.rx = 0x80;
+    m_ps3_report.ry = 0x80;
+    m_ps3_report.unknown_0x02_1 = 0x02;
+    m_ps3_report.battery = 0xef;
+    m_ps3_report.unknown_0x12 = 0x12;
+    m_ps3_report.unknown[0] = 0x12;
+    m_ps3_report.unknown[1] = 0xf8;
+    m_ps3_report.unknown[2] = 0x77;
+    m_ps3_report.unknown[3] = 0x00;
+    m_ps3_report.unknown[4] = 0x40;
+    m_ps3_report.acc_x = 511;
+    m_ps3_report.acc_y = 511;
+    m_ps3_report.acc_z = 511;
+    m_ps3_report.unknown_0x02_2 = 0x02;
+
+    m_ps4_report.report_id = 0x01;
+    m_ps4_report.lx = 0x80;
+    m_ps4_report.ly = 0x80;
+    m_ps4_report.rx = 0x80;
+    m_ps4_report.ry = 0x80;
+    m_ps4_report.battery = 0 | (1 << 4) | 11; // Cable connected and fully charged
+    m_ps4_report.peripheral = 0x01;
+    m_ps4_report.touch_report_count = 0;
+}
+
+uint32_t DONCON_HOT_FUNC(InputState::getDigitalState)() const {
+    return 0                                   //
+           | (drum.don_left.triggered << 0)    //
+           | (drum.ka_left.triggered << 1)     //
+           | (drum.don_right.triggered << 2)   //
+           | (drum.ka_right.triggered << 3)    //
+           | (controller.dpad.up << 4)         //
+           | (controller.dpad.down << 5)       //
+           | (controller.dpad.left << 6)       //
+           | (controller.dpad.right << 7)      //
+           | (controller.buttons.north << 8)   //
+           | (controller.buttons.east << 9)    //
+           | (controller.buttons.south << 10)  //
+           | (controller.buttons.west << 11)   //
+           | (controller.buttons.l << 12)      //
+           | (controller.buttons.r << 13)      //
+           | (controller.buttons.start << 14)  //
+           | (controller.buttons.select << 15) //
+           | (controller.buttons.home << 16)   //
+           | (controller.buttons.share << 17); //
+}
+
+std::array<uint16_t, 4> DONCON_HOT_FUNC(InputState::getAnalogState)() const {
+    return {drum.don_left.analog, drum.ka_left.analog, drum.don_right.analog, drum.ka_right.analog};
+}
+
+usb_report_t DONCON_HOT_FUNC(InputState::getReport)(usb_mode_t mode) {
+    bool changed = !m_last_mode.has_value() || m_last_mode.value() != mode;
+
+    switch (mode) {
+    case USB_MODE_XBOX360_ANALOG_P1:
+    case USB_MODE_XBOX360_ANALOG_P2:
+        changed = changed || getAnalogState() != m_last_analog_state;
+        [[fallthrough]];
+    case USB_MODE_SWITCH_TATACON:
+    case USB_MODE_SWITCH_HORIPAD:
+    case USB_MODE_DUALSHOCK3:
+    case USB_MODE_PS4_TATACON:
+    case USB_MODE_DUALSHOCK4:
+    case USB_MODE_KEYBOARD_P1:
+    case USB_MODE_KEYBOARD_P2:
+    case USB_MODE_XBOX360:
+        changed = changed || getDigitalState() != m_last_digital_state;
+        break;
+    case USB_MODE_MIDI:
+    case USB_MODE_DEBUG:
+        // Those keep internal state between calls and need to be updated every time.
+        changed = true;
+        break;
+    }
+
+    if (!changed) {
+        m_report_stats.skipped++;
+        return {getReportBuffer(mode), m_last_report_size};
+    }
+
+    const auto report = buildReport(mode);
+
+    m_report_stats.encoded++;
+    m_last_encode_us = to_us_since_boot(get_absolute_time());
+    m_last_mode = mode;
+    m_last_digital_state = getDigitalState();
+    m_last_analog_state = getAnalogState();
+    m_last_report_size = report.size;
+
+    return report;
+}
 
-usb_report_t InputState::getReport(usb_mode_t mode) {
+uint8_t *DONCON_HOT_FUNC(InputState::getReportBuffer)(usb_mode_t mode) {
+    switch (mode) {
+    case USB_MODE_SWITCH_TATACON:
+    case USB_MODE_SWITCH_HORIPAD:
+        return (uint8_t *)&m_switch_report;
+    case USB_MODE_DUALSHOCK3:
+        return (uint8_t *)&m_ps3_report;
+    case USB_MODE_PS4_TATACON:
+    case USB_MODE_DUALSHOCK4:
+        return (uint8_t *)&m_ps4_report;
+    case USB_MODE_KEYBOARD_P1:
+    case USB_MODE_KEYBOARD_P2:
+        return (uint8_t *)&m_keyboard_report;
+    case USB_MODE_XBOX360:
+    case USB_MODE_XBOX360_ANALOG_P1:
+    case USB_MODE_XBOX360_ANALOG_P2:
+        return (uint8_t *)&m_xinput_report;
+    case USB_MODE_MIDI:
+        return (uint8_t *)&m_midi_report;
+    case USB_MODE_DEBUG:
+        break;
+    }
+
+    return (uint8_t *)m_debug_report.c_str();
+}
+
+usb_report_t DONCON_HOT_FUNC(InputState::buildReport)(usb_mode_t mode) {
     switch (mode) {
     case USB_MODE_SWITCH_TATACON:
     case USB_MODE_SWITCH_HORIPAD:
@@ -42,7 +173,7 @@ usb_report_t InputState::getReport(usb_mode_t mode) {
     return getDebugReport();
 }
 
-static uint8_t getHidHat(const InputState::Controller::DPad dpad) {
+static uint8_t DONCON_HOT_FUNC(getHidHat)(const InputState::Controller::DPad dpad) {
     if (dpad.up && dpad.right) {
         return 0x01;
     } else if (dpad.down && dpad.right) {
@@ -64,7 +195,7 @@ static uint8_t getHidHat(const InputState::Controller::DPad dpad) {
     return 0x08;
 }
 
-usb_report_t InputState::getSwitchReport() {
+usb_report_t DONCON_HOT_FUNC(InputState::getSwitchReport)() {
     m_switch_report.buttons = 0                                             //
                               | (controller.buttons.west ? (1 << 0) : 0)    // Y
                               | (controller.buttons.south ? (1 << 1) : 0)   // B
@@ -83,20 +214,10 @@ usb_report_t InputState::getSwitchReport() {
 
     m_switch_report.hat = getHidHat(controller.dpad);
 
-    // Center all sticks
-    m_switch_report.lx = 0x80;
-    m_switch_report.ly = 0x80;
-    m_switch_report.rx = 0x80;
-    m_switch_report.ry = 0x80;
-
     return {(uint8_t *)&m_switch_report, sizeof(hid_switch_report_t)};
 }
 
-usb_report_t InputState::getPS3InputReport() {
-    memset(&m_ps3_report, 0, sizeof(m_ps3_report));
-
-    m_ps3_report.report_id = 0x01;
-
+usb_report_t DONCON_HOT_FUNC(InputState::getPS3InputReport)() {
     m_ps3_report.buttons1 = 0                                             //
                             | (controller.buttons.select ? (1 << 0) : 0)  // Select
                             | (drum.don_left.triggered ? (1 << 1) : 0)    // L3
@@ -116,47 +237,15 @@ usb_report_t InputState::getPS3InputReport() {
                             | (controller.buttons.west ? (1 << 7) : 0);   // Square
     m_ps3_report.buttons3 = 0 | (controller.buttons.home ? (1 << 0) : 0); // Home
 
-    // Center all sticks
-    m_ps3_report.lx = 0x80;
-    m_ps3_report.ly = 0x80;
-    m_ps3_report.rx = 0x80;
-    m_ps3_report.ry = 0x80;
-
     m_ps3_report.lt = (drum.ka_left.triggered ? 0xff : 0);
     m_ps3_report.rt = (drum.ka_right.triggered ? 0xff : 0);
 
-    m_ps3_report.unknown_0x02_1 = 0x02;
-    m_ps3_report.battery = 0xef;
-    m_ps3_report.unknown_0x12 = 0x12;
-
-    m_ps3_report.unknown[0] = 0x12;
-    m_ps3_report.unknown[1] = 0xf8;
-    m_ps3_report.unknown[2] = 0x77;
-    m_ps3_report.unknown[3] = 0x00;
-    m_ps3_report.unknown[4] = 0x40;
-
-    m_ps3_report.acc_x = 511;
-    m_ps3_report.acc_y = 511;
-    m_ps3_report.acc_z = 511;
-
-    m_ps3_report.unknown_0x02_2 = 0x02;
-
     return {(uint8_t *)&m_ps3_report, sizeof(hid_ps3_report_t)};
 }
 
-usb_report_t InputState::getPS4InputReport() {
+usb_report_t DONCON_HOT_FUNC(InputState::getPS4InputReport)() {
     static uint8_t report_counter = 0;
 
-    memset(&m_ps4_report, 0, sizeof(m_ps4_report));
-
-    m_ps4_report.report_id = 0x01;
-
-    // Center all sticks
-    m_ps4_report.lx = 0x80;
-    m_ps4_report.ly = 0x80;
-    m_ps4_report.rx = 0x80;
-    m_ps4_report.ry = 0x80;
-
     m_ps4_report.buttons1 = getHidHat(controller.dpad)                    //
                             | (controller.buttons.west ? (1 << 4) : 0)    // Square
                             | (controller.buttons.south ? (1 << 5) : 0)   // Cross
@@ -178,13 +267,8 @@ usb_report_t InputState::getPS4InputReport() {
     m_ps4_report.lt = (drum.ka_left.triggered ? 0xFF : 0);
     m_ps4_report.rt = (drum.ka_right.triggered ? 0xFF : 0);
 
-    m_ps4_report.battery = 0 | (1 << 4) | 11; // Cable connected and fully charged
-    m_ps4_report.peripheral = 0x01;
-    m_ps4_report.touch_report_count = 0;
-
-    // This method actually gets called more often than the report is sent,
-    // so counters are not consecutive ... let's see if this turns out to
-    // be a problem.
+    // The report is only rebuilt if any input changed, so counters are not
+    // consecutive ... let's see if this turns out to be a problem.
     report_counter++;
     if (report_counter > (UINT8_MAX >> 2)) {
         report_counter = 0;
@@ -193,7 +277,7 @@ usb_report_t InputState::getPS4InputReport() {
     return {(uint8_t *)&m_ps4_report, sizeof(hid_ps4_report_t)};
 }
 
-usb_report_t InputState::getKeyboardReport(InputState::Player player) {
+usb_report_t DONCON_HOT_FUNC(InputState::getKeyboardReport)(InputState::Player player) {
     m_keyboard_report = {.keycodes = {0}};
 
     auto set_key = [&](const bool input, const uint8_t keycode) {
@@ -238,7 +322,7 @@ usb_report_t InputState::getKeyboardReport(InputState::Player player) {
     return {(uint8_t *)&m_keyboard_report, sizeof(hid_nkro_keyboard_report_t)};
 }
 
-usb_report_t InputState::getXinputBaseReport() {
+usb_report_t DONCON_HOT_FUNC(InputState::getXinputBaseReport)() {
     m_xinput_report.buttons1 = 0                                            //
                                | (controller.dpad.up ? (1 << 0) : 0)        // Dpad Up
                                | (controller.dpad.down ? (1 << 1) : 0)      // Dpad Down
@@ -269,7 +353,7 @@ usb_report_t InputState::getXinputBaseReport() {
     return {(uint8_t *)&m_xinput_report, sizeof(xinput_report_t)};
 }
 
-usb_report_t InputState::getXinputDigitalReport() {
+usb_report_t DONCON_HOT_FUNC(InputState::getXinputDigitalReport)() {
     getXinputBaseReport();
 
     m_xinput_report.buttons1 |= (drum.don_left.triggered ? (1 << 1) : 0)   // Dpad Down
@@ -281,7 +365,7 @@ usb_report_t InputState::getXinputDigitalReport() {
     return {(uint8_t *)&m_xinput_report, sizeof(xinput_report_t)};
 }
 
-usb_report_t InputState::getXinputAnalogReport(InputState::Player player) {
+usb_report_t DONCON_HOT_FUNC(InputState::getXinputAnalogReport)(InputState::Player player) {
     getXinputBaseReport();
 
     int16_t x = 0;
@@ -315,7 +399,7 @@ usb_report_t InputState::getXinputAnalogReport(InputState::Player player) {
     return {(uint8_t *)&m_xinput_report, sizeof(xinput_report_t)};
 }
 
-usb_report_t InputState::getMidiReport() {
+usb_report_t DONCON_HOT_FUNC(InputState::getMidiReport)() {
     struct state {
         bool last_triggered;
         bool on;
@@ -390,11 +474,16 @@ usb_report_t InputState::getDebugReport() {
 }
 
 void InputState::releaseAll() {
-    drum = {{false, 0, 0}, {false, 0, 0}, {false, 0, 0}, {false, 0, 0}, 0, 0};
+    drum = {{false, 0, 0}, {false, 0, 0}, {false, 0, 0}, {false, 0, 0}, 0, 0, 0, 0};
     controller = {{false, false, false, false}, {false, false, false, false, false, false, false, false, false, false}};
 }
 
-bool InputState::checkHotkey() {
+void InputState::resetReports() {
+    m_last_mode = std::nullopt;
+    m_last_report_size = 0;
+}
+
+bool DONCON_HOT_FUNC(InputState::checkHotkey)() {
     static uint32_t hold_since = 0;
     static bool hold_active = false;
     static const uint32_t hold_timeout = 2000;
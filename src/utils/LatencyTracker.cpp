@@ -0,0 +1,83 @@
+#include "utils/LatencyTracker.h"
+
+#include "usb/device_driver.h"
+
+#include "pico/time.h"
+
+#include <algorithm>
+
+namespace Doncon::Utils {
+
+static bool isBefore(const uint32_t a_us, const uint32_t b_us) { return static_cast<int32_t>(a_us - b_us) < 0; }
+
+LatencyTracker::LatencyTracker()
+    : m_stage(Stage::Idle), m_last_detect_us(0), m_sample_us(0), m_detect_us(0), m_encode_us(0), m_queue_us(0) {
+    reset();
+}
+
+void LatencyTracker::reset() {
+    for (auto &histogram : m_report.spans) {
+        histogram = {{}, 0, UINT32_MAX, 0, 0};
+    }
+    m_report.dropped = 0;
+}
+
+void LatencyTracker::record(Span span, uint32_t from_us, uint32_t to_us) {
+    auto &histogram = m_report.spans[static_cast<size_t>(span)];
+
+    const uint32_t duration_us = isBefore(to_us, from_us) ? 0 : to_us - from_us;
+
+    histogram.buckets[std::min<size_t>(duration_us / bucket_us, bucket_count - 1)]++;
+    histogram.count++;
+    histogram.min_us = std::min(histogram.min_us, duration_us);
+    histogram.max_us = std::max(histogram.max_us, duration_us);
+    histogram.sum_us += duration_us;
+}
+
+void LatencyTracker::update(const InputState &input_state) {
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+
+    // Hits during a measurement are ignored, a 0 timestamp means the input state has been reset.
+    if (input_state.drum.hit_detect_us != m_last_detect_us) {
+        m_last_detect_us = input_state.drum.hit_detect_us;
+
+        if (m_stage == Stage::Idle && m_last_detect_us != 0) {
+            m_sample_us = input_state.drum.hit_sample_us;
+            m_detect_us = input_state.drum.hit_detect_us;
+            m_stage = Stage::Detected;
+        }
+    }
+
+    if (m_stage == Stage::Detected && !isBefore(input_state.getLastEncodeTime(), m_detect_us)) {
+        m_encode_us = input_state.getLastEncodeTime();
+        m_stage = Stage::Encoded;
+    }
+
+    usbd_report_timing_t timing;
+    usbd_driver_get_report_timing(&timing);
+
+    if (m_stage == Stage::Encoded && !isBefore(timing.queued_us, m_encode_us)) {
+        m_queue_us = timing.queued_us;
+        m_stage = Stage::Queued;
+    }
+
+    if (m_stage == Stage::Queued && timing.queued_us == m_queue_us && timing.completed) {
+        record(Span::SampleToDetect, m_sample_us, m_detect_us);
+        record(Span::DetectToEncode, m_detect_us, m_encode_us);
+        record(Span::EncodeToQueue, m_encode_us, m_queue_us);
+        record(Span::QueueToComplete, m_queue_us, timing.completed_us);
+        record(Span::Total, m_sample_us, timing.completed_us);
+
+        m_stage = Stage::Idle;
+    } else if (m_stage != Stage::Idle) {
+        // Either superseded by another report before its transfer finished, or never sent at all.
+        const bool superseded = m_stage == Stage::Queued && timing.queued_us != m_queue_us;
+
+        if (superseded || (now - m_detect_us) > m_timeout_us) {
+            m_report.dropped++;
+            m_stage = Stage::Idle;
+        }
+    }
+}
+
+} // namespace Doncon::Utils
@@ -0,0 +1,57 @@
+#include "utils/LoopProfiler.h"
+
+#include "utils/HotPath.h"
+
+#include "pico/time.h"
+
+#include <algorithm>
+
+namespace Doncon::Utils {
+
+namespace {
+
+size_t DONCON_HOT_FUNC(getBucket)(const uint32_t value_us) {
+    return std::min<size_t>(value_us ? 31 - __builtin_clz(value_us) : 0, LoopProfiler::bucket_count - 1);
+}
+
+} // namespace
+
+LoopProfiler::LoopProfiler(const uint32_t window_us)
+    : m_window_us(window_us), m_last_tick_us(0), m_last_duration_us(0), m_started(false) {
+    reset(m_current);
+    reset(m_report);
+}
+
+void LoopProfiler::reset(Report &report) { report = {0, UINT32_MAX, 0, 0, 0, {}, {}}; }
+
+void DONCON_HOT_FUNC(LoopProfiler::tick)() {
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+
+    if (!m_started) {
+        m_started = true;
+        m_last_tick_us = now;
+        return;
+    }
+
+    const uint32_t duration_us = now - m_last_tick_us;
+    const uint32_t jitter_us =
+        duration_us > m_last_duration_us ? duration_us - m_last_duration_us : m_last_duration_us - duration_us;
+
+    m_current.iterations++;
+    m_current.min_us = std::min(m_current.min_us, duration_us);
+    m_current.max_us = std::max(m_current.max_us, duration_us);
+    m_current.max_jitter_us = std::max(m_current.max_jitter_us, jitter_us);
+    m_current.sum_us += duration_us;
+    m_current.buckets[getBucket(duration_us)]++;
+    m_current.jitter_buckets[getBucket(jitter_us)]++;
+
+    m_last_tick_us = now;
+    m_last_duration_us = duration_us;
+
+    if (m_current.sum_us >= m_window_us) {
+        m_report = m_current;
+        reset(m_current);
+    }
+}
+
+} // namespace Doncon::Utils
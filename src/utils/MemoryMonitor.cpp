@@ -0,0 +1,75 @@
+#include "utils/MemoryMonitor.h"
+
+#include "pico/platform.h"
+
+// Provided by the SDK's linker script. Core1's stack is the one multicore_launch_core1() uses.
+extern "C" {
+extern uint32_t __StackBottom;
+extern uint32_t __StackTop;
+extern uint32_t __StackOneBottom;
+extern uint32_t __StackOneTop;
+extern char __StackLimit; // Historically named, this is the upper limit of the heap
+extern char __data_start__;
+extern char __data_end__;
+extern char __bss_start__;
+extern char __bss_end__;
+extern char end;
+}
+
+namespace Doncon::Utils {
+
+namespace {
+
+struct StackBounds {
+    uint32_t *bottom;
+    uint32_t *top;
+};
+
+StackBounds getStackBounds(const uint8_t core) {
+    if (core == 0) {
+        return {&__StackBottom, &__StackTop};
+    }
+    return {&__StackOneBottom, &__StackOneTop};
+}
+
+} // namespace
+
+void MemoryMonitor::paintStack() {
+    const auto bounds = getStackBounds(get_core_num());
+
+    uint32_t *stack_pointer;
+    asm volatile("mov %0, sp" : "=r"(stack_pointer));
+
+    // Leave some headroom for interrupts, which might hit while painting.
+    const uint32_t *paint_end = stack_pointer - 16;
+
+    for (volatile uint32_t *word = bounds.bottom; word < paint_end; ++word) {
+        *word = m_paint_pattern;
+    }
+}
+
+MemoryMonitor::Report MemoryMonitor::getReport() {
+    Report result;
+
+    for (uint8_t core = 0; core < core_count; ++core) {
+        const auto bounds = getStackBounds(core);
+
+        const volatile uint32_t *word = bounds.bottom;
+        while (word < bounds.top && *word == m_paint_pattern) {
+            ++word;
+        }
+
+        const uint32_t size = (bounds.top - bounds.bottom) * sizeof(uint32_t);
+        const uint32_t unused = (word - bounds.bottom) * sizeof(uint32_t);
+
+        result.stacks[core] = {size, size - unused, unused == 0};
+    }
+
+    result.data_bytes = &__data_end__ - &__data_start__;
+    result.bss_bytes = &__bss_end__ - &__bss_start__;
+    result.heap_size = &__StackLimit - &end;
+
+    return result;
+}
+
+} // namespace Doncon::Utils
@@ -1,123 +1,201 @@
 #include "utils/Menu.h"
 
+#include "GlobalConfiguration.h"
+
+#include <algorithm>
+
 namespace Doncon::Utils {
 
-const std::map<Menu::Page, const Menu::Descriptor> Menu::descriptors = {
-    {Menu::Page::Main,                                            //
-     {Menu::Descriptor::Type::Menu,                               //
-      "Settings",                                                 //
-      {{"Mode", Menu::Descriptor::Action::GotoPageDeviceMode},    //
-       {"Drum", Menu::Descriptor::Action::GotoPageDrum},          //
-       {"Led", Menu::Descriptor::Action::GotoPageLed},            //
-       {"Reset", Menu::Descriptor::Action::GotoPageReset},        //
-       {"USB Flash", Menu::Descriptor::Action::GotoPageBootsel}}, //
-      0}},                                                        //
-
-    {Menu::Page::DeviceMode,                                 //
-     {Menu::Descriptor::Type::Selection,                     //
-      "Mode",                                                //
-      {{"Swtch Tata", Menu::Descriptor::Action::SetUsbMode}, //
-       {"Swtch Pro", Menu::Descriptor::Action::SetUsbMode},  //
-       {"Dualshock3", Menu::Descriptor::Action::SetUsbMode}, //
-       {"PS4 Tata", Menu::Descriptor::Action::SetUsbMode},   //
-       {"Dualshock4", Menu::Descriptor::Action::SetUsbMode}, //
-       {"Keybrd P1", Menu::Descriptor::Action::SetUsbMode},  //
-       {"Keybrd P2", Menu::Descriptor::Action::SetUsbMode},  //
-       {"Xbox 360", Menu::Descriptor::Action::SetUsbMode},   //
-       {"Analog P1", Menu::Descriptor::Action::SetUsbMode},  //
-       {"Analog P2", Menu::Descriptor::Action::SetUsbMode},  //
-       {"MIDI", Menu::Descriptor::Action::SetUsbMode},       //
-       {"Debug", Menu::Descriptor::Action::SetUsbMode}},     //
-      0}},                                                   //
-
-    {Menu::Page::Drum,                                                                //
-     {Menu::Descriptor::Type::Menu,                                                   //
-      "Drum Settings",                                                                //
-      {{"Hold Time", Menu::Descriptor::Action::GotoPageDrumDebounceDelay},            //
-       {"Left Ka", Menu::Descriptor::Action::GotoPageDrumTriggerThresholdKaLeft},     //
-       {"Left Don", Menu::Descriptor::Action::GotoPageDrumTriggerThresholdDonLeft},   //
-       {"Right Don", Menu::Descriptor::Action::GotoPageDrumTriggerThresholdDonRight}, //
-       {"Right Ka", Menu::Descriptor::Action::GotoPageDrumTriggerThresholdKaRight}},  //
-      0}},                                                                            //
-
-    {Menu::Page::DrumDebounceDelay,                           //
-     {Menu::Descriptor::Type::Value,                          //
-      "Hit Hold Time (ms)",                                   //
-      {{"", Menu::Descriptor::Action::SetDrumDebounceDelay}}, //
-      UINT8_MAX}},
-
-    {Menu::Page::DrumTriggerThresholdKaLeft,                           //
-     {Menu::Descriptor::Type::Value,                                   //
-      "Trg Level Left Ka",                                             //
-      {{"", Menu::Descriptor::Action::SetDrumTriggerThresholdKaLeft}}, //
-      4095}},
-
-    {Menu::Page::DrumTriggerThresholdDonLeft,                           //
-     {Menu::Descriptor::Type::Value,                                    //
-      "Trg Level Left Don",                                             //
-      {{"", Menu::Descriptor::Action::SetDrumTriggerThresholdDonLeft}}, //
-      4095}},
-
-    {Menu::Page::DrumTriggerThresholdDonRight,                           //
-     {Menu::Descriptor::Type::Value,                                     //
-      "Trg Level Right Don",                                             //
-      {{"", Menu::Descriptor::Action::SetDrumTriggerThresholdDonRight}}, //
-      4095}},
-
-    {Menu::Page::DrumTriggerThresholdKaRight,                           //
-     {Menu::Descriptor::Type::Value,                                    //
-      "Trg Level Right Ka",                                             //
-      {{"", Menu::Descriptor::Action::SetDrumTriggerThresholdKaRight}}, //
-      4095}},
-
-    {Menu::Page::Led,                                                           //
-     {Menu::Descriptor::Type::Menu,                                             //
-      "LED Settings",                                                           //
-      {{"Brightness", Menu::Descriptor::Action::GotoPageLedBrightness},         //
-       {"Plyr Color", Menu::Descriptor::Action::GotoPageLedEnablePlayerColor}}, //
-      0}},                                                                      //
-
-    {Menu::Page::LedBrightness,                           //
-     {Menu::Descriptor::Type::Value,                      //
-      "LED Brightness",                                   //
-      {{"", Menu::Descriptor::Action::SetLedBrightness}}, //
-      UINT8_MAX}},                                        //
-
-    {Menu::Page::LedEnablePlayerColor,                           //
-     {Menu::Descriptor::Type::Toggle,                            //
-      "Player Color (PS4)",                                      //
-      {{"", Menu::Descriptor::Action::SetLedEnablePlayerColor}}, //
-      0}},                                                       //
-
-    {Menu::Page::Reset,                              //
-     {Menu::Descriptor::Type::Menu,                  //
-      "Reset all Settings?",                         //
-      {{"No", Menu::Descriptor::Action::GotoParent}, //
-       {"Yes", Menu::Descriptor::Action::DoReset}},  //
-      0}},                                           //
-
-    {Menu::Page::Bootsel,                                         //
-     {Menu::Descriptor::Type::Menu,                               //
-      "Reboot to Flash Mode",                                     //
-      {{"Reboot?", Menu::Descriptor::Action::DoRebootToBootsel}}, //
-      0}},                                                        //
-
-    {Menu::Page::BootselMsg,                         //
-     {Menu::Descriptor::Type::RebootInfo,            //
-      "Ready to Flash...",                           //
-      {{"BOOTSEL", Menu::Descriptor::Action::None}}, //
-      0}},                                           //
-};
+namespace {
+
+using Page = Menu::Page;
+using Type = Menu::Descriptor::Type;
+using Action = Menu::Descriptor::Action;
+using Item = Menu::Descriptor::Item;
+
+// Settings with a plain getter/setter pair.
+template <typename T, T (SettingsStore::*get)(), void (SettingsStore::*set)(T)> constexpr Menu::Binding bindSetting() {
+    return {[](SettingsStore &store) { return static_cast<uint16_t>((store.*get)()); },
+            [](SettingsStore &store, uint16_t value) { (store.*set)(static_cast<T>(value)); }};
+}
+
+template <uint16_t Peripherals::Drum::Config::Thresholds::*field> constexpr Menu::Binding bindThreshold() {
+    return {[](SettingsStore &store) { return store.getTriggerThresholds().*field; },
+            [](SettingsStore &store, uint16_t value) {
+                auto thresholds = store.getTriggerThresholds();
+
+                thresholds.*field = value;
+                store.setTriggerThresholds(thresholds);
+            }};
+}
+
+// Timing of the currently selected USB mode.
+template <uint8_t usb_timing_t::*field> constexpr Menu::Binding bindUsbTiming() {
+    return {[](SettingsStore &store) { return static_cast<uint16_t>(store.getUsbTiming(store.getUsbMode()).*field); },
+            [](SettingsStore &store, uint16_t value) {
+                auto timing = store.getUsbTiming(store.getUsbMode());
+
+                timing.*field = value;
+                store.setUsbTiming(store.getUsbMode(), timing);
+            }};
+}
+
+constexpr Menu::Binding no_binding = {nullptr, nullptr};
+
+constexpr std::array<Item, 9> main_items = {{
+    {"Profile", Action::GotoPage, Page::Profile},
+    {"Mode", Action::GotoPage, Page::DeviceMode},
+    {"USB", Action::GotoPage, Page::Usb},
+    {"Drum", Action::GotoPage, Page::Drum},
+    {"Buttons", Action::GotoPage, Page::Buttons},
+    {"Led", Action::GotoPage, Page::Led},
+    {"Latency", Action::GotoPage, Page::Latency},
+    {"Reset", Action::GotoPage, Page::Reset},
+    {"USB Flash", Action::GotoPage, Page::Bootsel},
+}};
+
+constexpr std::array<Item, SettingsStore::profile_count> makeProfileItems() {
+    std::array<Item, SettingsStore::profile_count> items = {};
+    for (size_t idx = 0; idx < items.size(); ++idx) {
+        items[idx] = {Config::Default::settings_profile_names[idx], Action::SetValue, Page::Main};
+    }
+    return items;
+}
+
+constexpr auto profile_items = makeProfileItems();
+
+constexpr std::array<Item, USB_MODE_COUNT> device_mode_items = {{
+    {"Swtch Tata", Action::SetValue, Page::Main},
+    {"Swtch Pro", Action::SetValue, Page::Main},
+    {"Dualshock3", Action::SetValue, Page::Main},
+    {"PS4 Tata", Action::SetValue, Page::Main},
+    {"Dualshock4", Action::SetValue, Page::Main},
+    {"Keybrd P1", Action::SetValue, Page::Main},
+    {"Keybrd P2", Action::SetValue, Page::Main},
+    {"Xbox 360", Action::SetValue, Page::Main},
+    {"Analog P1", Action::SetValue, Page::Main},
+    {"Analog P2", Action::SetValue, Page::Main},
+    {"MIDI", Action::SetValue, Page::Main},
+    {"Debug", Action::SetValue, Page::Main},
+}};
+
+constexpr std::array<Item, 2> usb_items = {{
+    {"Poll Rate", Action::GotoPage, Page::UsbInterval},
+    {"Pacing", Action::GotoPage, Page::UsbPacing},
+}};
+
+constexpr std::array<Item, 5> drum_items = {{
+    {"Hold Time", Action::GotoPage, Page::DrumDebounceDelay},
+    {"Left Ka", Action::GotoPage, Page::DrumTriggerThresholdKaLeft},
+    {"Left Don", Action::GotoPage, Page::DrumTriggerThresholdDonLeft},
+    {"Right Don", Action::GotoPage, Page::DrumTriggerThresholdDonRight},
+    {"Right Ka", Action::GotoPage, Page::DrumTriggerThresholdKaRight},
+}};
+
+constexpr std::array<Item, 1> buttons_items = {{
+    {"SOCD", Action::GotoPage, Page::ButtonsSocdMode},
+}};
+
+constexpr std::array<Item, 4> socd_mode_items = {{
+    {"Last Wins", Action::SetValue, Page::Main},
+    {"First Wins", Action::SetValue, Page::Main},
+    {"Neutral", Action::SetValue, Page::Main},
+    {"Up Prio", Action::SetValue, Page::Main},
+}};
+
+constexpr std::array<Item, 2> led_items = {{
+    {"Brightness", Action::GotoPage, Page::LedBrightness},
+    {"Plyr Color", Action::GotoPage, Page::LedEnablePlayerColor},
+}};
+
+constexpr std::array<Item, 1> latency_items = {{{"", Action::GotoPage, Page::LoopProfile}}};
+constexpr std::array<Item, 1> loop_profile_items = {{{"", Action::GotoParent, Page::Main}}};
+
+constexpr std::array<Item, 2> reset_items = {{
+    {"No", Action::GotoParent, Page::Main},
+    {"Yes", Action::DoReset, Page::Main},
+}};
+
+constexpr std::array<Item, 1> bootsel_items = {{{"Reboot?", Action::DoRebootToBootsel, Page::Main}}};
+constexpr std::array<Item, 1> bootsel_msg_items = {{{"BOOTSEL", Action::None, Page::Main}}};
+
+template <size_t N> constexpr Menu::Descriptor menuPage(Page page, Type type, std::string_view name,
+                                                        const std::array<Item, N> &items,
+                                                        const Menu::Binding binding = no_binding) {
+    return {page, type, name, items.data(), N, 0, binding};
+}
+
+constexpr Menu::Descriptor valuePage(Page page, Type type, std::string_view name, uint16_t max_value,
+                                     const Menu::Binding binding) {
+    return {page, type, name, nullptr, 0, max_value, binding};
+}
+
+} // namespace
+
+constexpr std::array<Menu::Descriptor, Menu::page_count> Menu::descriptors = {{
+    menuPage(Page::Main, Type::Menu, "Settings", main_items),
+
+    menuPage(Page::Profile, Type::Selection, "Profile", profile_items,
+             bindSetting<uint8_t, &SettingsStore::getActiveProfile, &SettingsStore::setActiveProfile>()),
+    menuPage(Page::DeviceMode, Type::Selection, "Mode", device_mode_items,
+             bindSetting<usb_mode_t, &SettingsStore::getUsbMode, &SettingsStore::setUsbMode>()),
+    menuPage(Page::Usb, Type::Menu, "USB Settings", usb_items),
+    menuPage(Page::Drum, Type::Menu, "Drum Settings", drum_items),
+    menuPage(Page::Buttons, Type::Menu, "Button Settings", buttons_items),
+    menuPage(Page::Led, Type::Menu, "LED Settings", led_items),
+    menuPage(Page::Latency, Type::Info, "Hit Latency", latency_items),
+    menuPage(Page::Reset, Type::Menu, "Reset all Settings?", reset_items),
+    menuPage(Page::Bootsel, Type::Menu, "Reboot to Flash Mode", bootsel_items),
+
+    valuePage(Page::UsbInterval, Type::Value, "Poll Interval (ms)", UINT8_MAX,
+              bindUsbTiming<&usb_timing_t::interval_ms>()),
+    valuePage(Page::UsbPacing, Type::Value, "Rpt Pacing (frames)", UINT8_MAX,
+              bindUsbTiming<&usb_timing_t::pacing_frames>()),
+
+    valuePage(Page::DrumDebounceDelay, Type::Value, "Hit Hold Time (ms)", UINT8_MAX,
+              bindSetting<uint16_t, &SettingsStore::getDebounceDelay, &SettingsStore::setDebounceDelay>()),
+    valuePage(Page::DrumTriggerThresholdKaLeft, Type::Value, "Trg Level Left Ka", 4095,
+              bindThreshold<&Peripherals::Drum::Config::Thresholds::ka_left>()),
+    valuePage(Page::DrumTriggerThresholdDonLeft, Type::Value, "Trg Level Left Don", 4095,
+              bindThreshold<&Peripherals::Drum::Config::Thresholds::don_left>()),
+    valuePage(Page::DrumTriggerThresholdDonRight, Type::Value, "Trg Level Right Don", 4095,
+              bindThreshold<&Peripherals::Drum::Config::Thresholds::don_right>()),
+    valuePage(Page::DrumTriggerThresholdKaRight, Type::Value, "Trg Level Right Ka", 4095,
+              bindThreshold<&Peripherals::Drum::Config::Thresholds::ka_right>()),
+
+    menuPage(Page::ButtonsSocdMode, Type::Selection, "SOCD Mode", socd_mode_items,
+             bindSetting<Peripherals::Buttons::SocdMode, &SettingsStore::getSocdMode, &SettingsStore::setSocdMode>()),
+
+    valuePage(Page::LedBrightness, Type::Value, "LED Brightness", UINT8_MAX,
+              bindSetting<uint8_t, &SettingsStore::getLedBrightness, &SettingsStore::setLedBrightness>()),
+    valuePage(Page::LedEnablePlayerColor, Type::Toggle, "Player Color (PS4)", 1,
+              bindSetting<bool, &SettingsStore::getLedEnablePlayerColor, &SettingsStore::setLedEnablePlayerColor>()),
+
+    menuPage(Page::LoopProfile, Type::Info, "Loop Timing", loop_profile_items),
+
+    menuPage(Page::BootselMsg, Type::RebootInfo, "Ready to Flash...", bootsel_msg_items),
+}};
+
+static constexpr bool descriptorsIndexedByPage() {
+    for (size_t idx = 0; idx < Menu::descriptors.size(); ++idx) {
+        if (static_cast<size_t>(Menu::descriptors[idx].page) != idx) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(descriptorsIndexedByPage(), "Menu descriptors must be in the order of Menu::Page");
 
 Menu::Menu(std::shared_ptr<SettingsStore> settings_store)
-    : m_store(settings_store), m_active(false), m_state_stack({{Page::Main, 0, 0}}) {};
+    : m_store(settings_store), m_active(false), m_state_stack({{Page::Main, 0, 0, false}}) {};
 
 void Menu::activate() {
-    m_state_stack = std::stack<State>({{Page::Main, 0, 0}});
+    m_state_stack = std::stack<State>({{Page::Main, 0, 0, false}});
     m_active = true;
 }
 
-static InputState::Controller checkPressed(const InputState::Controller &controller_state) {
+// Held directions repeat after repeat_delay, repeat_ms is set to how long up or down have been repeating.
+static InputState::Controller checkPressed(const InputState::Controller &controller_state, uint32_t &repeat_ms) {
     struct ButtonState {
         enum State {
             Idle,
@@ -136,6 +214,8 @@ static InputState::Controller checkPressed(const InputState::Controller &control
     static ButtonState state_east = {ButtonState::State::Idle, 0, 0};
     static ButtonState state_south = {ButtonState::State::Idle, 0, 0};
     static ButtonState state_west = {ButtonState::State::Idle, 0, 0};
+    static ButtonState state_l = {ButtonState::State::Idle, 0, 0};
+    static ButtonState state_r = {ButtonState::State::Idle, 0, 0};
 
     static ButtonState state_up = {ButtonState::State::Idle, 0, 0};
     static ButtonState state_down = {ButtonState::State::Idle, 0, 0};
@@ -145,7 +225,9 @@ static InputState::Controller checkPressed(const InputState::Controller &control
     InputState::Controller result{{false, false, false, false},
                                   {false, false, false, false, false, false, false, false, false, false}};
 
-    auto handle_button = [](ButtonState &button_state, bool input_state) {
+    repeat_ms = 0;
+
+    auto handle_button = [](ButtonState &button_state, bool input_state, uint32_t *repeating_ms = nullptr) {
         bool result = false;
         if (input_state) {
             uint32_t now = to_ms_since_boot(get_absolute_time());
@@ -171,6 +253,9 @@ static InputState::Controller checkPressed(const InputState::Controller &control
                 } else {
                     result = false;
                 }
+                if (repeating_ms) {
+                    *repeating_ms = now - button_state.pressed_since - repeat_delay;
+                }
                 break;
             }
         } else {
@@ -185,49 +270,47 @@ static InputState::Controller checkPressed(const InputState::Controller &control
     result.buttons.east = handle_button(state_east, controller_state.buttons.east);
     result.buttons.south = handle_button(state_south, controller_state.buttons.south);
     result.buttons.west = handle_button(state_west, controller_state.buttons.west);
+    result.buttons.l = handle_button(state_l, controller_state.buttons.l);
+    result.buttons.r = handle_button(state_r, controller_state.buttons.r);
 
-    result.dpad.up = handle_button(state_up, controller_state.dpad.up);
-    result.dpad.down = handle_button(state_down, controller_state.dpad.down);
+    result.dpad.up = handle_button(state_up, controller_state.dpad.up, &repeat_ms);
+    result.dpad.down = handle_button(state_down, controller_state.dpad.down, &repeat_ms);
     result.dpad.left = handle_button(state_left, controller_state.dpad.left);
     result.dpad.right = handle_button(state_right, controller_state.dpad.right);
 
     return result;
 }
 
+// The step doubles every acceleration_interval while a direction keeps repeating. Coarse steps
+// cover the whole range of a value in coarse_step_count steps.
+static uint16_t getValueStep(const Menu::Descriptor &descriptor, bool coarse, uint32_t repeat_ms) {
+    static const uint32_t acceleration_interval = 500;
+    static const uint32_t acceleration_max_shift = 4;
+    static const uint16_t coarse_step_count = 64;
+
+    const uint16_t base_step = coarse ? std::max(1, (descriptor.max_value + 1) / coarse_step_count) : 1;
+
+    return base_step << std::min(repeat_ms / acceleration_interval, acceleration_max_shift);
+}
+
 uint16_t Menu::getCurrentValue(Menu::Page page) {
-    switch (page) {
-    case Page::DeviceMode:
-        return static_cast<uint16_t>(m_store->getUsbMode());
-    case Page::DrumDebounceDelay:
-        return m_store->getDebounceDelay();
-    case Page::DrumTriggerThresholdKaLeft:
-        return m_store->getTriggerThresholds().ka_left;
-    case Page::DrumTriggerThresholdDonLeft:
-        return m_store->getTriggerThresholds().don_left;
-    case Page::DrumTriggerThresholdDonRight:
-        return m_store->getTriggerThresholds().don_right;
-    case Page::DrumTriggerThresholdKaRight:
-        return m_store->getTriggerThresholds().ka_right;
-    case Page::LedBrightness:
-        return m_store->getLedBrightness();
-    case Page::LedEnablePlayerColor:
-        return static_cast<uint16_t>(m_store->getLedEnablePlayerColor());
-    case Page::Main:
-    case Page::Drum:
-    case Page::Led:
-    case Page::Reset:
-    case Page::Bootsel:
-    case Page::BootselMsg:
-        break;
-    }
+    const auto &binding = getDescriptor(page).binding;
 
-    return 0;
+    return binding.get ? binding.get(*m_store) : 0;
+}
+
+void Menu::setValue(Menu::Page page, uint16_t value) {
+    const auto &binding = getDescriptor(page).binding;
+
+    if (binding.set) {
+        binding.set(*m_store, value);
+    }
 }
 
 void Menu::gotoPage(Menu::Page page) {
     const auto current_value = getCurrentValue(page);
 
-    m_state_stack.push({page, current_value, current_value});
+    m_state_stack.push({page, current_value, current_value, false});
 }
 
 void Menu::gotoParent(bool do_restore) {
@@ -238,134 +321,24 @@ void Menu::gotoParent(bool do_restore) {
     }
 
     if (do_restore) {
-        switch (current_state.page) {
-        case Page::DeviceMode:
-            m_store->setUsbMode(static_cast<usb_mode_t>(current_state.original_value));
-            break;
-        case Page::DrumDebounceDelay:
-            m_store->setDebounceDelay(current_state.original_value);
-            break;
-        case Page::DrumTriggerThresholdKaLeft: {
-            auto thresholds = m_store->getTriggerThresholds();
-
-            thresholds.ka_left = current_state.original_value;
-            m_store->setTriggerThresholds(thresholds);
-        } break;
-        case Page::DrumTriggerThresholdDonLeft: {
-            auto thresholds = m_store->getTriggerThresholds();
-
-            thresholds.don_left = current_state.original_value;
-            m_store->setTriggerThresholds(thresholds);
-        } break;
-        case Page::DrumTriggerThresholdDonRight: {
-            auto thresholds = m_store->getTriggerThresholds();
-
-            thresholds.don_right = current_state.original_value;
-            m_store->setTriggerThresholds(thresholds);
-        } break;
-        case Page::DrumTriggerThresholdKaRight: {
-            auto thresholds = m_store->getTriggerThresholds();
-
-            thresholds.ka_right = current_state.original_value;
-            m_store->setTriggerThresholds(thresholds);
-        } break;
-        case Page::LedBrightness:
-            m_store->setLedBrightness(current_state.original_value);
-            break;
-        case Page::LedEnablePlayerColor:
-            m_store->setLedEnablePlayerColor(static_cast<bool>(current_state.original_value));
-            break;
-        case Page::Main:
-        case Page::Drum:
-        case Page::Led:
-        case Page::Reset:
-        case Page::Bootsel:
-        case Page::BootselMsg:
-            break;
-        }
+        setValue(current_state.page, current_state.original_value);
     }
 
     m_state_stack.pop();
 }
 
-void Menu::performAction(Descriptor::Action action, uint8_t value) {
-    switch (action) {
+void Menu::performAction(const Descriptor::Item &item, uint16_t value) {
+    switch (item.action) {
     case Descriptor::Action::None:
         break;
     case Descriptor::Action::GotoParent:
         gotoParent(false);
         break;
-    case Descriptor::Action::GotoPageDeviceMode:
-        gotoPage(Page::DeviceMode);
-        break;
-    case Descriptor::Action::GotoPageDrum:
-        gotoPage(Page::Drum);
-        break;
-    case Descriptor::Action::GotoPageLed:
-        gotoPage(Page::Led);
-        break;
-    case Descriptor::Action::GotoPageReset:
-        gotoPage(Page::Reset);
-        break;
-    case Descriptor::Action::GotoPageBootsel:
-        gotoPage(Page::Bootsel);
-        break;
-    case Descriptor::Action::GotoPageDrumDebounceDelay:
-        gotoPage(Page::DrumDebounceDelay);
-        break;
-    case Descriptor::Action::GotoPageDrumTriggerThresholdKaLeft:
-        gotoPage(Page::DrumTriggerThresholdKaLeft);
-        break;
-    case Descriptor::Action::GotoPageDrumTriggerThresholdDonLeft:
-        gotoPage(Page::DrumTriggerThresholdDonLeft);
-        break;
-    case Descriptor::Action::GotoPageDrumTriggerThresholdDonRight:
-        gotoPage(Page::DrumTriggerThresholdDonRight);
-        break;
-    case Descriptor::Action::GotoPageDrumTriggerThresholdKaRight:
-        gotoPage(Page::DrumTriggerThresholdKaRight);
-        break;
-    case Descriptor::Action::GotoPageLedBrightness:
-        gotoPage(Page::LedBrightness);
-        break;
-    case Descriptor::Action::GotoPageLedEnablePlayerColor:
-        gotoPage(Page::LedEnablePlayerColor);
+    case Descriptor::Action::GotoPage:
+        gotoPage(item.target);
         break;
-    case Descriptor::Action::SetUsbMode:
-        m_store->setUsbMode(static_cast<usb_mode_t>(value));
-        break;
-    case Descriptor::Action::SetDrumDebounceDelay:
-        m_store->setDebounceDelay(value);
-        break;
-    case Descriptor::Action::SetDrumTriggerThresholdKaLeft: {
-        auto thresholds = m_store->getTriggerThresholds();
-
-        thresholds.ka_left = value;
-        m_store->setTriggerThresholds(thresholds);
-    } break;
-    case Descriptor::Action::SetDrumTriggerThresholdDonLeft: {
-        auto thresholds = m_store->getTriggerThresholds();
-
-        thresholds.don_left = value;
-        m_store->setTriggerThresholds(thresholds);
-    } break;
-    case Descriptor::Action::SetDrumTriggerThresholdDonRight: {
-        auto thresholds = m_store->getTriggerThresholds();
-
-        thresholds.don_right = value;
-        m_store->setTriggerThresholds(thresholds);
-    } break;
-    case Descriptor::Action::SetDrumTriggerThresholdKaRight: {
-        auto thresholds = m_store->getTriggerThresholds();
-
-        thresholds.ka_right = value;
-        m_store->setTriggerThresholds(thresholds);
-    } break;
-    case Descriptor::Action::SetLedBrightness:
-        m_store->setLedBrightness(value);
-        break;
-    case Descriptor::Action::SetLedEnablePlayerColor:
-        m_store->setLedEnablePlayerColor(static_cast<bool>(value));
+    case Descriptor::Action::SetValue:
+        setValue(m_state_stack.top().page, value);
         break;
     case Descriptor::Action::DoReset:
         m_store->reset();
@@ -375,125 +348,137 @@ void Menu::performAction(Descriptor::Action action, uint8_t value) {
         gotoPage(Page::BootselMsg);
         break;
     }
-
-    return;
 }
 
 void Menu::update(const InputState::Controller &controller_state) {
-    InputState::Controller pressed = checkPressed(controller_state);
+    uint32_t repeat_ms;
+    InputState::Controller pressed = checkPressed(controller_state, repeat_ms);
     State &current_state = m_state_stack.top();
+    const auto &descriptor = getDescriptor(current_state.page);
+    const uint16_t step = getValueStep(descriptor, current_state.coarse, repeat_ms);
 
-    auto descriptor_it = descriptors.find(current_state.page);
-    if (descriptor_it == descriptors.end()) {
-        assert(false);
-        return;
-    }
-
-    if (descriptor_it->second.type == Descriptor::Type::RebootInfo) {
+    if (descriptor.type == Descriptor::Type::RebootInfo) {
         m_active = false;
     } else if (pressed.dpad.left) {
-        switch (descriptor_it->second.type) {
+        switch (descriptor.type) {
         case Descriptor::Type::Toggle:
             current_state.selected_value = !current_state.selected_value;
-            performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+            setValue(current_state.page, current_state.selected_value);
             break;
         case Descriptor::Type::Selection:
             if (current_state.selected_value == 0) {
-                current_state.selected_value = descriptor_it->second.items.size() - 1;
+                current_state.selected_value = descriptor.item_count - 1;
             } else {
                 current_state.selected_value--;
             }
-            performAction(descriptor_it->second.items.at(current_state.selected_value).second,
-                          current_state.selected_value);
+            performAction(descriptor.items[current_state.selected_value], current_state.selected_value);
             break;
         case Descriptor::Type::Menu:
             if (current_state.selected_value == 0) {
-                current_state.selected_value = descriptor_it->second.items.size() - 1;
+                current_state.selected_value = descriptor.item_count - 1;
             } else {
                 current_state.selected_value--;
             }
             break;
         case Descriptor::Type::Value:
+        case Descriptor::Type::Info:
         case Descriptor::Type::RebootInfo:
             break;
         }
     } else if (pressed.dpad.right) {
-        switch (descriptor_it->second.type) {
+        switch (descriptor.type) {
         case Descriptor::Type::Toggle:
             current_state.selected_value = !current_state.selected_value;
-            performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+            setValue(current_state.page, current_state.selected_value);
             break;
         case Descriptor::Type::Selection:
-            if (current_state.selected_value == descriptor_it->second.items.size() - 1) {
+            if (current_state.selected_value == descriptor.item_count - 1) {
                 current_state.selected_value = 0;
             } else {
                 current_state.selected_value++;
             }
-            performAction(descriptor_it->second.items.at(current_state.selected_value).second,
-                          current_state.selected_value);
+            performAction(descriptor.items[current_state.selected_value], current_state.selected_value);
             break;
         case Descriptor::Type::Menu:
-            if (current_state.selected_value == descriptor_it->second.items.size() - 1) {
+            if (current_state.selected_value == descriptor.item_count - 1) {
                 current_state.selected_value = 0;
             } else {
                 current_state.selected_value++;
             }
             break;
         case Descriptor::Type::Value:
+        case Descriptor::Type::Info:
         case Descriptor::Type::RebootInfo:
             break;
         }
     } else if (pressed.dpad.up) {
-        switch (descriptor_it->second.type) {
+        switch (descriptor.type) {
         case Descriptor::Type::Value:
-            if (current_state.selected_value < UINT8_MAX) {
-                current_state.selected_value++;
-                performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+            if (current_state.selected_value < descriptor.max_value) {
+                current_state.selected_value =
+                    std::min<uint32_t>(current_state.selected_value + step, descriptor.max_value);
+                setValue(current_state.page, current_state.selected_value);
             }
             break;
         case Descriptor::Type::Toggle:
         case Descriptor::Type::Selection:
         case Descriptor::Type::Menu:
+        case Descriptor::Type::Info:
         case Descriptor::Type::RebootInfo:
             break;
         }
     } else if (pressed.dpad.down) {
-        switch (descriptor_it->second.type) {
+        switch (descriptor.type) {
         case Descriptor::Type::Value:
             if (current_state.selected_value > 0) {
-                current_state.selected_value--;
-                performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+                current_state.selected_value =
+                    current_state.selected_value > step ? current_state.selected_value - step : 0;
+                setValue(current_state.page, current_state.selected_value);
             }
             break;
         case Descriptor::Type::Toggle:
         case Descriptor::Type::Selection:
         case Descriptor::Type::Menu:
+        case Descriptor::Type::Info:
+        case Descriptor::Type::RebootInfo:
+            break;
+        }
+    } else if (pressed.buttons.l || pressed.buttons.r) { // Fine/Coarse
+        switch (descriptor.type) {
+        case Descriptor::Type::Value:
+            current_state.coarse = pressed.buttons.r;
+            break;
+        case Descriptor::Type::Toggle:
+        case Descriptor::Type::Selection:
+        case Descriptor::Type::Menu:
+        case Descriptor::Type::Info:
         case Descriptor::Type::RebootInfo:
             break;
         }
     } else if (pressed.buttons.south) { // Back/Exit
-        switch (descriptor_it->second.type) {
+        switch (descriptor.type) {
         case Descriptor::Type::Value:
         case Descriptor::Type::Toggle:
         case Descriptor::Type::Selection:
             gotoParent(true);
             break;
         case Descriptor::Type::Menu:
+        case Descriptor::Type::Info:
             gotoParent(false);
             break;
         case Descriptor::Type::RebootInfo:
             break;
         }
     } else if (pressed.buttons.east) { // Select
-        switch (descriptor_it->second.type) {
+        switch (descriptor.type) {
         case Descriptor::Type::Value:
         case Descriptor::Type::Toggle:
         case Descriptor::Type::Selection:
             gotoParent(false);
             break;
         case Descriptor::Type::Menu:
-            performAction(descriptor_it->second.items.at(current_state.selected_value).second,
-                          current_state.selected_value);
+        case Descriptor::Type::Info:
+            performAction(descriptor.items[current_state.selected_value], current_state.selected_value);
             break;
         case Descriptor::Type::RebootInfo:
             break;
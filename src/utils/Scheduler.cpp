@@ -0,0 +1,70 @@
+#include "utils/Scheduler.h"
+
+#include "utils/Trace.h"
+
+#include "pico/time.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Doncon::Utils {
+
+Scheduler::Scheduler() : m_tasks() { m_tasks.reserve(max_tasks); }
+
+void Scheduler::addTask(const char *name, const uint32_t period_us, std::function<void()> function,
+                        const uint32_t deadline_us) {
+    assert(m_tasks.size() < max_tasks);
+    assert(period_us > 0);
+
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+
+    m_tasks.push_back({function, now, {name, period_us, deadline_us ? deadline_us : period_us, 0, 0, 0, 0, 0}});
+}
+
+void Scheduler::update() {
+    const uint32_t now = to_us_since_boot(get_absolute_time());
+
+    for (size_t idx = 0; idx < m_tasks.size(); ++idx) {
+        auto &task = m_tasks[idx];
+
+        const auto latency = static_cast<int32_t>(now - task.next_due_us);
+        if (latency < 0) {
+            continue;
+        }
+
+        TRACE_BEGIN(TRACE_SCHEDULER_TASK, idx);
+        task.function();
+        TRACE_END(TRACE_SCHEDULER_TASK, idx);
+
+        const uint32_t exec_us = static_cast<uint32_t>(to_us_since_boot(get_absolute_time())) - now;
+
+        auto &stats = task.stats;
+        stats.runs++;
+        stats.last_exec_us = exec_us;
+        stats.max_exec_us = std::max(stats.max_exec_us, exec_us);
+        stats.max_latency_us = std::max(stats.max_latency_us, static_cast<uint32_t>(latency));
+        if (static_cast<uint32_t>(latency) + exec_us > stats.deadline_us) {
+            stats.overruns++;
+        }
+
+        // Don't try to catch up on missed periods, just continue from now.
+        task.next_due_us += stats.period_us;
+        if (static_cast<int32_t>(now - task.next_due_us) >= 0) {
+            task.next_due_us = now + stats.period_us;
+        }
+
+        return;
+    }
+}
+
+Scheduler::Report Scheduler::getReport() const {
+    Report report = {static_cast<uint8_t>(m_tasks.size()), {}};
+
+    for (size_t idx = 0; idx < m_tasks.size(); ++idx) {
+        report.tasks[idx] = m_tasks[idx].stats;
+    }
+
+    return report;
+}
+
+} // namespace Doncon::Utils
@@ -0,0 +1,61 @@
+#include "utils/SettingsImport.h"
+
+#include "pico/stdio.h"
+#include "pico/time.h"
+
+namespace Doncon::Utils {
+
+SettingsImport::SettingsImport() : m_blob({}), m_digits(0), m_valid(false), m_active(false), m_last_char_us(0) {}
+
+void SettingsImport::start() {
+    m_digits = 0;
+    m_valid = true;
+    m_active = true;
+    m_last_char_us = time_us_32();
+}
+
+SettingsImport::Result SettingsImport::receive() {
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        m_last_char_us = time_us_32();
+
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else if (c == '\r' || c == ' ') {
+            continue;
+        } else if (c == '\n') {
+            m_active = false;
+            return (m_valid && m_digits % 2 == 0) ? Result::Complete : Result::Failed;
+        } else {
+            // Keep reading, so the rest of the line isn't taken as commands.
+            m_valid = false;
+            continue;
+        }
+
+        if (m_digits / 2 >= m_blob.size()) {
+            m_valid = false;
+            continue;
+        }
+
+        m_blob[m_digits / 2] = (m_digits % 2 == 0) ? (nibble << 4) : (m_blob[m_digits / 2] | nibble);
+        m_digits++;
+    }
+
+    if ((time_us_32() - m_last_char_us) > m_char_timeout_us) {
+        m_active = false;
+        return Result::Failed;
+    }
+
+    return Result::Pending;
+}
+
+bool SettingsImport::apply(SettingsStore &settings_store) const {
+    return settings_store.importSettings(m_blob.data(), m_digits / 2);
+}
+
+} // namespace Doncon::Utils
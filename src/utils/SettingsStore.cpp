@@ -1,4 +1,6 @@
 #include "utils/SettingsStore.h"
+#include "utils/Crc32.h"
+#include "utils/Trace.h"
 
 #include "GlobalConfiguration.h"
 
@@ -6,112 +8,592 @@
 #include "pico/bootrom.h"
 #include "pico/multicore.h"
 
+#include <algorithm>
+#include <stddef.h>
+#include <string.h>
+
 namespace Doncon::Utils {
 
+namespace {
+
+// The journal occupies the last sectors of the flash.
+const uint8_t journal_sectors = Config::Default::settings_journal_sectors;
+const uint32_t journal_offset = PICO_FLASH_SIZE_BYTES - journal_sectors * FLASH_SECTOR_SIZE;
+
+// Sector used by firmware before the journal, only read for migration.
+const uint32_t unjournaled_offset = PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE;
+
+static_assert(journal_sectors >= 1 && journal_sectors <= 64);
+
+// Layout written by firmware before the record format.
+struct __attribute((packed, aligned(1))) LegacyStorecache {
+    uint8_t in_use;
+    usb_mode_t usb_mode;
+    Peripherals::Drum::Config::Thresholds trigger_thresholds;
+    uint8_t led_brightness;
+    bool led_enable_player_color;
+    uint16_t debounce_delay;
+    Peripherals::Buttons::SocdMode socd_mode;
+    usb_timing_t usb_timing[USB_MODE_COUNT]; // Zeroed by versions which did not know about it yet
+};
+
+// Header of the record format before the journal, one complete set of records per page.
+struct __attribute((packed, aligned(1))) SinglePageHeader {
+    uint8_t magic;
+    uint8_t schema_version;
+    uint16_t length;
+    uint32_t crc32; // Over the records only
+};
+
+bool isNewer(const uint32_t sequence, const uint32_t reference) {
+    return static_cast<int32_t>(sequence - reference) > 0;
+}
+
+} // namespace
+
 static uint8_t read_byte(uint32_t offset) { return *(reinterpret_cast<uint8_t *>(XIP_BASE + offset)); }
+static const uint8_t *flash_pointer(uint32_t offset) { return reinterpret_cast<const uint8_t *>(XIP_BASE + offset); }
+static uint32_t page_offset(uint8_t sector, uint8_t page) {
+    return journal_offset + sector * FLASH_SECTOR_SIZE + page * FLASH_PAGE_SIZE;
+}
 
 SettingsStore::SettingsStore()
-    : m_store_cache({m_magic_byte,
-                     Config::Default::usb_mode,
-                     Config::Default::drum_config.trigger_thresholds,
-                     Config::Default::led_config.brightness,
-                     Config::Default::led_config.enable_player_color,
-                     Config::Default::drum_config.debounce_delay_ms,
-                     {}}),
-      m_dirty(true), m_scheduled_reboot(RebootType::None) {
-    uint32_t current_page = m_flash_offset + m_flash_size - m_store_size;
-    bool found_valid = false;
-    for (uint8_t i = 0; i < m_store_pages; ++i) {
-        if (read_byte(current_page) == m_magic_byte) {
-            found_valid = true;
+    : m_settings(getDefaultSettings()), m_store_cache(nullptr), m_dirty(true), m_persisted(getDefaultSettings()),
+      m_journal_valid(false), m_sector(0), m_next_page(0), m_sequence(0), m_commit({}), m_last_input_us(0),
+      m_last_step_us(0), m_commit_stats({}), m_scheduled_reboot(RebootType::None) {
+
+    if (!readJournal()) {
+        readUnjournaled();
+    }
+
+    m_store_cache = &m_settings.profiles[m_settings.active_profile];
+}
+
+SettingsStore::Storecache SettingsStore::getDefaults() {
+    return {Config::Default::usb_mode,
+            Config::Default::drum_config.trigger_thresholds,
+            Config::Default::led_config.brightness,
+            Config::Default::led_config.enable_player_color,
+            Config::Default::drum_config.debounce_delay_ms,
+            Config::Default::button_config.socd_mode,
+            {}};
+}
+
+SettingsStore::Settings SettingsStore::getDefaultSettings() {
+    Settings settings = {0, {}};
+    settings.profiles.fill(getDefaults());
+
+    return settings;
+}
+
+size_t SettingsStore::encodeRecords(uint8_t *out, const Settings &settings, const Settings *base) {
+    size_t offset = 0;
+
+    if (!base || settings.active_profile != base->active_profile) {
+        out[offset++] = static_cast<uint8_t>(Tag::ActiveProfile);
+        out[offset++] = sizeof(settings.active_profile);
+        out[offset++] = settings.active_profile;
+    }
+
+    for (uint8_t profile = 0; profile < profile_count; ++profile) {
+        const size_t length = encodeProfileRecords(&out[offset + 3], settings.profiles[profile],
+                                                   base ? &base->profiles[profile] : nullptr);
+
+        // Profiles without changes are left out entirely.
+        if (length != 0) {
+            out[offset++] = static_cast<uint8_t>(Tag::Profile);
+            out[offset++] = sizeof(profile);
+            out[offset++] = profile;
+            offset += length;
+        }
+    }
+
+    return offset;
+}
+
+size_t SettingsStore::encodeProfileRecords(uint8_t *out, const Storecache &cache, const Storecache *base) {
+    size_t offset = 0;
+
+    // Records equal to the base are left out.
+    const Storecache &reference = base ? *base : cache;
+    const auto add_record = [&](const Tag tag, const auto &value, const auto &base_value) {
+        static_assert(sizeof(value) <= UINT8_MAX);
+
+        if (base && memcmp(&value, &base_value, sizeof(value)) == 0) {
+            return;
+        }
+
+        out[offset++] = static_cast<uint8_t>(tag);
+        out[offset++] = sizeof(value);
+        memcpy(&out[offset], &value, sizeof(value));
+        offset += sizeof(value);
+    };
+
+    add_record(Tag::UsbMode, static_cast<uint8_t>(cache.usb_mode), static_cast<uint8_t>(reference.usb_mode));
+    add_record(Tag::TriggerThresholds, cache.trigger_thresholds, reference.trigger_thresholds);
+    add_record(Tag::LedBrightness, cache.led_brightness, reference.led_brightness);
+    add_record(Tag::LedEnablePlayerColor, static_cast<uint8_t>(cache.led_enable_player_color),
+               static_cast<uint8_t>(reference.led_enable_player_color));
+    add_record(Tag::DebounceDelay, cache.debounce_delay, reference.debounce_delay);
+    add_record(Tag::SocdMode, static_cast<uint8_t>(cache.socd_mode), static_cast<uint8_t>(reference.socd_mode));
+    add_record(Tag::UsbTiming, cache.usb_timing, reference.usb_timing);
+
+    return offset;
+}
+
+bool SettingsStore::decodeRecords(const uint8_t *records, const size_t length, Settings &settings) {
+    // Records are self-describing, so pages from newer schema versions can be read as well. Migrations
+    // from older versions go here once the meaning of a tag needs to change.
+    Storecache *cache = &settings.profiles[0];
+    bool valid = true;
+
+    const uint8_t *record = records;
+    const uint8_t *const end = records + length;
+    while (end - record >= 2) {
+        const auto tag = static_cast<Tag>(record[0]);
+        const uint8_t value_length = record[1];
+        const uint8_t *value = record + 2;
+
+        if (end - value < value_length) {
+            valid = false;
+            break;
+        }
+
+        // Records of profiles this firmware doesn't have are skipped.
+        if (!cache && tag != Tag::Profile && tag != Tag::ActiveProfile) {
+            record = value + value_length;
+            continue;
+        }
+
+        const auto read_value = [&](auto &target) {
+            if (value_length == sizeof(target)) {
+                memcpy(&target, value, sizeof(target));
+            } else {
+                valid = false;
+            }
+        };
+
+        switch (tag) {
+        case Tag::UsbMode:
+            if (value_length == 1 && value[0] < USB_MODE_COUNT) {
+                cache->usb_mode = static_cast<usb_mode_t>(value[0]);
+            } else {
+                valid = false;
+            }
+            break;
+        case Tag::TriggerThresholds:
+            read_value(cache->trigger_thresholds);
+            break;
+        case Tag::LedBrightness:
+            read_value(cache->led_brightness);
+            break;
+        case Tag::LedEnablePlayerColor:
+            if (value_length == 1) {
+                cache->led_enable_player_color = value[0] != 0;
+            } else {
+                valid = false;
+            }
+            break;
+        case Tag::DebounceDelay:
+            read_value(cache->debounce_delay);
+            break;
+        case Tag::SocdMode:
+            if (value_length == 1 && value[0] <= static_cast<uint8_t>(Peripherals::Buttons::SocdMode::UpPriority)) {
+                cache->socd_mode = static_cast<Peripherals::Buttons::SocdMode>(value[0]);
+            } else {
+                valid = false;
+            }
+            break;
+        case Tag::UsbTiming:
+            memcpy(cache->usb_timing, value, std::min<size_t>(value_length, sizeof(cache->usb_timing)));
+            break;
+        case Tag::Profile:
+            cache = (value_length == 1 && value[0] < profile_count) ? &settings.profiles[value[0]] : nullptr;
+            break;
+        case Tag::ActiveProfile:
+            if (value_length == 1 && value[0] < profile_count) {
+                settings.active_profile = value[0];
+            } else {
+                valid = false;
+            }
             break;
-        } else {
-            current_page -= m_store_size;
         }
+
+        record = value + value_length;
     }
 
-    if (found_valid) {
-        m_store_cache = *(reinterpret_cast<Storecache *>(XIP_BASE + current_page));
-        m_dirty = false;
+    return valid && record == end;
+}
+
+bool SettingsStore::readHeader(const uint8_t *page, PageHeader &header) {
+    memcpy(&header, page, sizeof(header));
+
+    const size_t crc_start = offsetof(PageHeader, sequence);
+
+    return header.magic == m_magic_byte && header.length <= m_page_size - sizeof(PageHeader) &&
+           crc32(page + crc_start, sizeof(PageHeader) - crc_start + header.length) == header.crc32;
+}
+
+bool SettingsStore::readJournal() {
+    // The sector whose snapshot has the highest sequence number is the current one.
+    PageHeader header;
+    bool found = false;
+    for (uint8_t sector = 0; sector < journal_sectors; ++sector) {
+        if (!readHeader(flash_pointer(page_offset(sector, 0)), header) || header.type != PageType::Snapshot) {
+            continue;
+        }
+        if (!found || isNewer(header.sequence, m_sequence)) {
+            found = true;
+            m_sector = sector;
+            m_sequence = header.sequence;
+        }
     }
+
+    if (!found) {
+        return false;
+    }
+
+    // Apply the deltas up to the first erased page. Corrupted pages are skipped, but can't be reused.
+    auto settings = getDefaultSettings();
+    bool outdated = false;
+
+    m_next_page = 0;
+    for (uint8_t page = 0; page < m_pages_per_sector; ++page) {
+        const uint8_t *data = flash_pointer(page_offset(m_sector, page));
+        if (data[0] == 0xFF) {
+            break;
+        }
+        m_next_page = page + 1;
+
+        if (!readHeader(data, header) || (page == 0) != (header.type == PageType::Snapshot) ||
+            (page != 0 && !isNewer(header.sequence, m_sequence))) {
+            continue;
+        }
+
+        decodeRecords(data + sizeof(PageHeader), header.length, settings);
+        m_sequence = header.sequence;
+        outdated = outdated || header.schema_version < m_schema_version;
+    }
+
+    m_settings = settings;
+    m_persisted = settings;
+    m_journal_valid = true;
+    m_dirty = outdated;
+
+    return true;
 }
 
-void SettingsStore::setUsbMode(const usb_mode_t mode) {
-    if (mode != m_store_cache.usb_mode) {
-        m_store_cache.usb_mode = mode;
+bool SettingsStore::readUnjournaled() {
+    // Pages were written in order, so the last valid one is the current one. Corrupted pages are skipped.
+    for (int page = m_pages_per_sector - 1; page >= 0; --page) {
+        const uint32_t offset = unjournaled_offset + page * FLASH_PAGE_SIZE;
+        const uint8_t *data = flash_pointer(offset);
+
+        switch (read_byte(offset)) {
+        case m_single_page_magic_byte: {
+            SinglePageHeader header;
+            memcpy(&header, data, sizeof(header));
+
+            if (header.length <= m_page_size - sizeof(header) &&
+                crc32(data + sizeof(header), header.length) == header.crc32) {
+                decodeRecords(data + sizeof(header), header.length, m_settings);
+                return true;
+            }
+        } break;
+        case m_legacy_magic_byte: {
+            LegacyStorecache legacy;
+            memcpy(&legacy, data, sizeof(legacy));
+
+            if (legacy.usb_mode < USB_MODE_COUNT) {
+                auto &profile = m_settings.profiles[0];
+
+                profile = {legacy.usb_mode,
+                           legacy.trigger_thresholds,
+                           legacy.led_brightness,
+                           legacy.led_enable_player_color,
+                           legacy.debounce_delay,
+                           legacy.socd_mode,
+                           {}};
+                memcpy(profile.usb_timing, legacy.usb_timing, sizeof(profile.usb_timing));
+                return true;
+            }
+        } break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+void SettingsStore::setActiveProfile(const uint8_t profile) {
+    if (profile < profile_count && profile != m_settings.active_profile) {
+        m_settings.active_profile = profile;
+        m_store_cache = &m_settings.profiles[profile];
         m_dirty = true;
+    }
+}
+
+uint8_t SettingsStore::getActiveProfile() { return m_settings.active_profile; }
 
-        scheduleReboot();
+void SettingsStore::setUsbMode(const usb_mode_t mode) {
+    if (mode != m_store_cache->usb_mode) {
+        m_store_cache->usb_mode = mode;
+        m_dirty = true;
     }
 }
 
-usb_mode_t SettingsStore::getUsbMode() { return m_store_cache.usb_mode; }
+usb_mode_t SettingsStore::getUsbMode() { return m_store_cache->usb_mode; }
 
 void SettingsStore::setTriggerThresholds(const Peripherals::Drum::Config::Thresholds &thresholds) {
-    if (m_store_cache.trigger_thresholds.don_left != thresholds.don_left ||
-        m_store_cache.trigger_thresholds.don_right != thresholds.don_right ||
-        m_store_cache.trigger_thresholds.ka_left != thresholds.ka_left ||
-        m_store_cache.trigger_thresholds.ka_right != thresholds.ka_right) {
+    if (m_store_cache->trigger_thresholds.don_left != thresholds.don_left ||
+        m_store_cache->trigger_thresholds.don_right != thresholds.don_right ||
+        m_store_cache->trigger_thresholds.ka_left != thresholds.ka_left ||
+        m_store_cache->trigger_thresholds.ka_right != thresholds.ka_right) {
 
-        m_store_cache.trigger_thresholds = thresholds;
+        m_store_cache->trigger_thresholds = thresholds;
         m_dirty = true;
     }
 }
-Peripherals::Drum::Config::Thresholds SettingsStore::getTriggerThresholds() { return m_store_cache.trigger_thresholds; }
+Peripherals::Drum::Config::Thresholds SettingsStore::getTriggerThresholds() { return m_store_cache->trigger_thresholds; }
 
 void SettingsStore::setLedBrightness(const uint8_t brightness) {
-    if (m_store_cache.led_brightness != brightness) {
-        m_store_cache.led_brightness = brightness;
+    if (m_store_cache->led_brightness != brightness) {
+        m_store_cache->led_brightness = brightness;
         m_dirty = true;
     }
 }
-uint8_t SettingsStore::getLedBrightness() { return m_store_cache.led_brightness; }
+uint8_t SettingsStore::getLedBrightness() { return m_store_cache->led_brightness; }
 
 void SettingsStore::setLedEnablePlayerColor(const bool do_enable) {
-    if (m_store_cache.led_enable_player_color != do_enable) {
-        m_store_cache.led_enable_player_color = do_enable;
+    if (m_store_cache->led_enable_player_color != do_enable) {
+        m_store_cache->led_enable_player_color = do_enable;
         m_dirty = true;
     }
 }
-bool SettingsStore::getLedEnablePlayerColor() { return m_store_cache.led_enable_player_color; }
+bool SettingsStore::getLedEnablePlayerColor() { return m_store_cache->led_enable_player_color; }
 
 void SettingsStore::setDebounceDelay(const uint16_t delay) {
-    if (m_store_cache.debounce_delay != delay) {
-        m_store_cache.debounce_delay = delay;
+    if (m_store_cache->debounce_delay != delay) {
+        m_store_cache->debounce_delay = delay;
+        m_dirty = true;
+    }
+}
+uint16_t SettingsStore::getDebounceDelay() { return m_store_cache->debounce_delay; }
+
+void SettingsStore::setSocdMode(const Peripherals::Buttons::SocdMode mode) {
+    if (m_store_cache->socd_mode != mode) {
+        m_store_cache->socd_mode = mode;
+        m_dirty = true;
+    }
+}
+Peripherals::Buttons::SocdMode SettingsStore::getSocdMode() { return m_store_cache->socd_mode; }
+
+void SettingsStore::setUsbTiming(const usb_mode_t mode, const usb_timing_t &timing) {
+    auto &stored = m_store_cache->usb_timing[mode];
+
+    if (stored.interval_ms != timing.interval_ms || stored.pacing_frames != timing.pacing_frames) {
+        stored = timing;
         m_dirty = true;
     }
 }
-uint16_t SettingsStore::getDebounceDelay() { return m_store_cache.debounce_delay; }
+usb_timing_t SettingsStore::getUsbTiming(const usb_mode_t mode) {
+    const auto &stored = m_store_cache->usb_timing[mode];
+
+    // An interval of 0 is invalid and marks entries which have never been set, e.g. by older firmware.
+    if (stored.interval_ms == 0) {
+        return Config::Default::usb_timing[mode];
+    }
+    return stored;
+}
+
+size_t SettingsStore::exportSettings(uint8_t *out) const {
+    const size_t length = encodeRecords(&out[sizeof(BlobHeader)], m_settings, nullptr);
+
+    const BlobHeader header = {m_blob_magic_byte, m_schema_version, static_cast<uint16_t>(length),
+                               crc32(&out[sizeof(BlobHeader)], length)};
+    memcpy(out, &header, sizeof(header));
+
+    return sizeof(header) + length;
+}
+
+bool SettingsStore::importSettings(const uint8_t *blob, const size_t length) {
+    BlobHeader header;
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, blob, sizeof(header));
+
+    // Blobs of newer versions are accepted as long as they fit into a journal page, unknown tags are skipped.
+    if (header.magic != m_blob_magic_byte || header.length != length - sizeof(header) ||
+        header.length > m_page_size - sizeof(PageHeader) ||
+        crc32(blob + sizeof(header), header.length) != header.crc32) {
+        return false;
+    }
+
+    auto settings = getDefaultSettings();
+    if (!decodeRecords(blob + sizeof(header), header.length, settings)) {
+        return false;
+    }
+
+    m_settings = settings;
+    m_store_cache = &m_settings.profiles[m_settings.active_profile];
+    m_dirty = true;
+
+    return true;
+}
+
+void SettingsStore::encodeCommit() {
+    m_commit.cache = m_settings;
+    m_commit.data.fill(0xFF);
+
+    const size_t length = encodeRecords(&m_commit.data[sizeof(PageHeader)], m_commit.cache,
+                                        m_commit.type == PageType::Delta ? &m_persisted : nullptr);
+
+    // Nothing changed since the last write.
+    if (m_commit.type == PageType::Delta && length == 0) {
+        m_commit.program = false;
+        return;
+    }
+
+    PageHeader header = {m_magic_byte, m_schema_version, static_cast<uint16_t>(length), 0, m_commit.sequence,
+                         m_commit.type};
+    memcpy(m_commit.data.data(), &header, sizeof(header));
+
+    const size_t crc_start = offsetof(PageHeader, sequence);
+    header.crc32 = crc32(&m_commit.data[crc_start], sizeof(PageHeader) - crc_start + length);
+    memcpy(m_commit.data.data(), &header, sizeof(header));
+
+    m_commit.program = true;
+}
 
 void SettingsStore::store() {
+    TRACE_SCOPE(TRACE_SETTINGS_STORE, m_dirty);
+
     if (m_dirty) {
-        multicore_lockout_start_blocking();
-        uint32_t interrupts = save_and_disable_interrupts();
-
-        uint32_t current_page = m_flash_offset;
-        bool do_erase = true;
-        for (uint8_t i = 0; i < m_store_pages; ++i) {
-            if (read_byte(current_page) == 0xFF) {
-                do_erase = false;
-                break;
+        // A pending commit keeps its target and just gets its page replaced.
+        if (!m_commit.program) {
+            m_commit.sequence = m_sequence + 1;
+
+            if (m_commit.erase_count != 0) {
+                // Reset pending, start over with a snapshot in the first sector once everything is erased.
+                m_commit.sector = 0;
+                m_commit.page = 0;
+                m_commit.type = PageType::Snapshot;
+            } else if (m_journal_valid && m_next_page < m_pages_per_sector) {
+                m_commit.sector = m_sector;
+                m_commit.page = m_next_page;
+                m_commit.type = PageType::Delta;
             } else {
-                current_page += m_store_size;
+                // Sector full, continue with a snapshot in the next one. The previous sector stays
+                // intact until the snapshot has been written.
+                m_commit.sector = m_journal_valid ? (m_sector + 1) % journal_sectors : 0;
+                m_commit.page = 0;
+                m_commit.type = PageType::Snapshot;
+                m_commit.erase_sector = m_commit.sector;
+                m_commit.erase_count = 1;
             }
         }
 
-        if (do_erase) {
-            flash_range_erase(m_flash_offset, m_flash_size);
-            current_page = m_flash_offset;
-        }
-
-        flash_range_program(current_page, reinterpret_cast<uint8_t *>(&m_store_cache), sizeof(m_store_cache));
+        encodeCommit();
 
         m_dirty = false;
+    }
+
+    if (!commitPending()) {
+        reboot();
+    }
+}
+
+void SettingsStore::reset() {
+    m_commit.erase_sector = 0;
+    m_commit.erase_count = journal_sectors;
+    m_commit.program = false;
+
+    m_persisted = getDefaultSettings();
+    m_journal_valid = false;
+    m_dirty = false;
+
+    scheduleReboot();
+}
+
+void SettingsStore::update(const bool inputs_active) {
+    const uint32_t now = to_us_since_boot(get_absolute_time());
 
-        restore_interrupts_from_disabled(interrupts);
-        multicore_lockout_end_blocking();
+    if (inputs_active) {
+        m_last_input_us = now;
     }
 
+    if (!commitPending() || (now - m_last_input_us) < Config::Default::settings_commit_idle_ms * 1000 ||
+        (now - m_last_step_us) < Config::Default::settings_commit_step_gap_ms * 1000) {
+        return;
+    }
+
+    TRACE_SCOPE(TRACE_SETTINGS_STORE, m_commit.erase_count);
+
+    uint32_t blocking_us = 0;
+    if (m_commit.erase_count != 0) {
+        const uint32_t offset = page_offset(m_commit.erase_sector, 0);
+        blocking_us = runBlocking([offset]() { flash_range_erase(offset, FLASH_SECTOR_SIZE); });
+
+        m_commit.erase_sector++;
+        m_commit.erase_count--;
+        m_commit_stats.erases++;
+        m_commit_stats.last_erase_us = blocking_us;
+    } else {
+        const uint32_t offset = page_offset(m_commit.sector, m_commit.page);
+        blocking_us = runBlocking([this, offset]() {
+            flash_range_program(offset, m_commit.data.data(), m_commit.data.size());
+        });
+
+        m_commit.program = false;
+        m_commit_stats.programs++;
+        m_commit_stats.last_program_us = blocking_us;
+
+        m_persisted = m_commit.cache;
+        m_journal_valid = true;
+        m_sector = m_commit.sector;
+        m_next_page = m_commit.page + 1;
+        m_sequence = m_commit.sequence;
+    }
+
+    m_commit_stats.max_blocking_us = std::max(m_commit_stats.max_blocking_us, blocking_us);
+    if (blocking_us > Config::Default::settings_commit_budget_us) {
+        m_commit_stats.over_budget++;
+    }
+
+    m_last_step_us = to_us_since_boot(get_absolute_time());
+
+    if (!commitPending()) {
+        m_commit_stats.commits++;
+        reboot();
+    }
+}
+
+SettingsStore::CommitStats SettingsStore::getCommitStats() const {
+    auto result = m_commit_stats;
+    result.sequence = m_sequence;
+    result.sector = m_sector;
+    result.next_page = m_next_page;
+
+    return result;
+}
+
+template <typename T> uint32_t SettingsStore::runBlocking(T operation) {
+    multicore_lockout_start_blocking();
+    const uint32_t interrupts = save_and_disable_interrupts();
+    const uint32_t start_us = time_us_32();
+
+    operation();
+
+    const uint32_t duration_us = time_us_32() - start_us;
+    restore_interrupts_from_disabled(interrupts);
+    multicore_lockout_end_blocking();
+
+    return duration_us;
+}
+
+void SettingsStore::reboot() {
     switch (m_scheduled_reboot) {
     case RebootType::Normal:
         watchdog_reboot(0, 0, 1);
@@ -125,21 +607,6 @@ void SettingsStore::store() {
     }
 }
 
-void SettingsStore::reset() {
-    multicore_lockout_start_blocking();
-    uint32_t interrupts = save_and_disable_interrupts();
-
-    flash_range_erase(m_flash_offset, m_flash_size);
-
-    restore_interrupts(interrupts);
-    multicore_lockout_end_blocking();
-
-    m_dirty = false;
-
-    scheduleReboot();
-    store();
-}
-
 void SettingsStore::scheduleReboot(const bool bootsel) {
     if (m_scheduled_reboot != RebootType::Bootsel) {
         m_scheduled_reboot = (bootsel ? RebootType::Bootsel : RebootType::Normal);
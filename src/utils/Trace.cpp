@@ -0,0 +1,71 @@
+#include "utils/Trace.h"
+
+#if DONCON_TRACE
+
+#include "hardware/sync.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+
+#include <algorithm>
+
+static_assert((DONCON_TRACE_BUFFER_SIZE & (DONCON_TRACE_BUFFER_SIZE - 1)) == 0,
+              "Trace buffer size needs to be a power of two!");
+
+namespace {
+
+struct TraceBuffer {
+    trace_entry_t entries[DONCON_TRACE_BUFFER_SIZE];
+    volatile uint32_t head; // Total number of entries written, only incremented by the owning core
+};
+
+TraceBuffer trace_buffers[NUM_CORES] = {};
+volatile bool trace_enabled = true;
+
+} // namespace
+
+const char *const trace_event_names[TRACE_EVENT_COUNT] = {
+    "core0_loop",    //
+    "task",          //
+    "display",       //
+    "buttons",       //
+    "settings_save", //
+    "usb_send",      //
+};
+
+void trace_record(trace_event_t event, trace_phase_t phase, uint16_t arg) {
+    if (!trace_enabled) {
+        return;
+    }
+
+    auto &buffer = trace_buffers[get_core_num()];
+    const uint32_t head = buffer.head;
+
+    buffer.entries[head & (DONCON_TRACE_BUFFER_SIZE - 1)] = {static_cast<uint32_t>(time_us_32()),
+                                                             static_cast<uint8_t>(event), static_cast<uint8_t>(phase),
+                                                             arg};
+
+    // Publish the entry only after it has been written completely.
+    __dmb();
+    buffer.head = head + 1;
+}
+
+void trace_set_enabled(bool enabled) { trace_enabled = enabled; }
+
+uint32_t trace_read(uint8_t core, trace_entry_t *entries, uint32_t max_entries) {
+    if (core >= NUM_CORES) {
+        return 0;
+    }
+
+    const auto &buffer = trace_buffers[core];
+    const uint32_t head = buffer.head;
+    const uint32_t count = std::min({head, max_entries, static_cast<uint32_t>(DONCON_TRACE_BUFFER_SIZE)});
+
+    __dmb();
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        entries[idx] = buffer.entries[(head - count + idx) & (DONCON_TRACE_BUFFER_SIZE - 1)];
+    }
+
+    return count;
+}
+
+#endif // DONCON_TRACE
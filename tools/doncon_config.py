@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Reads and changes DonCon2040 settings via the USB config interface.
+
+The config interface is offered next to the controller in the modes enabled in
+usb_config_interface in GlobalConfiguration.h. Requires pyusb, on Linux the
+current user needs access to the device, e.g. via a udev rule.
+
+    ./doncon_config.py get
+    ./doncon_config.py set trigger_thresholds 30 10 30 10
+    ./doncon_config.py set usb_timing 1 0 --mode 5
+    ./doncon_config.py commit
+    ./doncon_config.py stream --interval 10
+
+Changes are applied right away, but only survive a power cycle once committed.
+A changed USB mode or polling interval takes effect on commit.
+"""
+
+import argparse
+import struct
+import sys
+
+INTERFACE_CLASS = 0xFF
+INTERFACE_SUBCLASS = 0xDC
+INTERFACE_PROTOCOL = 0x01
+
+REQUEST_GET = 0x01
+REQUEST_SET = 0x02
+REQUEST_COMMIT = 0x03
+REQUEST_STREAM = 0x04
+
+REQUEST_TYPE_IN = 0xC1  # Device to host, vendor, interface
+REQUEST_TYPE_OUT = 0x41  # Host to device, vendor, interface
+
+# Name: (field id, value format)
+FIELDS = {
+    "active_profile": (0x00, "<B"),
+    "usb_mode": (0x01, "<B"),
+    "trigger_thresholds": (0x02, "<4H"),  # Don left, Ka left, Don right, Ka right
+    "led_brightness": (0x03, "<B"),
+    "led_enable_player_color": (0x04, "<B"),
+    "debounce_delay": (0x05, "<H"),
+    "socd_mode": (0x06, "<B"),
+    "usb_timing": (0x07, "<2B"),  # Interval, pacing, indexed by USB mode
+}
+
+USB_MODE_COUNT = 12
+
+STREAM_FRAME = struct.Struct("<BBI8H")
+PAD_NAMES = ["don_left", "ka_left", "don_right", "ka_right"]
+
+
+class ConfigInterface:
+    def __init__(self):
+        import usb.core
+        import usb.util
+
+        for dev in usb.core.find(find_all=True):
+            for cfg in dev:
+                itf = usb.util.find_descriptor(cfg, bInterfaceClass=INTERFACE_CLASS,
+                                               bInterfaceSubClass=INTERFACE_SUBCLASS,
+                                               bInterfaceProtocol=INTERFACE_PROTOCOL)
+                if itf is not None:
+                    self.dev = dev
+                    self.itf = itf
+                    self.ep_in = itf[0].bEndpointAddress
+                    return
+
+        raise LookupError("No controller with config interface found")
+
+    def get(self, name, index=0):
+        field, fmt = FIELDS[name]
+        data = self.dev.ctrl_transfer(REQUEST_TYPE_IN, REQUEST_GET, field | (index << 8),
+                                      self.itf.bInterfaceNumber, struct.calcsize(fmt))
+        return struct.unpack(fmt, bytes(data))
+
+    def set(self, name, values, index=0):
+        field, fmt = FIELDS[name]
+        self.dev.ctrl_transfer(REQUEST_TYPE_OUT, REQUEST_SET, field | (index << 8), self.itf.bInterfaceNumber,
+                               struct.pack(fmt, *values))
+
+    def commit(self):
+        self.dev.ctrl_transfer(REQUEST_TYPE_OUT, REQUEST_COMMIT, 0, self.itf.bInterfaceNumber)
+
+    def set_stream_interval(self, interval_ms):
+        self.dev.ctrl_transfer(REQUEST_TYPE_OUT, REQUEST_STREAM, interval_ms, self.itf.bInterfaceNumber)
+
+    def read_frame(self, timeout_ms):
+        data = bytes(self.dev.read(self.ep_in, 64, timeout_ms))
+        return STREAM_FRAME.unpack(data[:STREAM_FRAME.size])
+
+
+def print_all(config):
+    for name in FIELDS:
+        if name == "usb_timing":
+            for mode in range(USB_MODE_COUNT):
+                print("%s[%d]: %s" % (name, mode, " ".join(str(v) for v in config.get(name, mode))))
+        else:
+            print("%s: %s" % (name, " ".join(str(v) for v in config.get(name))))
+
+
+def stream(config, interval_ms, count):
+    config.set_stream_interval(interval_ms)
+    try:
+        received = 0
+        while not count or received < count:
+            sequence, triggered, timestamp_us, *values = config.read_frame(max(1000, interval_ms * 10))
+            pads = " ".join("%s=%4d/%4d%s" % (name, values[2 * idx], values[2 * idx + 1],
+                                             "*" if triggered & (1 << idx) else " ")
+                            for idx, name in enumerate(PAD_NAMES))
+            print("%3d %10d  %s" % (sequence, timestamp_us, pads))
+            received += 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        config.set_stream_interval(0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    get_parser = commands.add_parser("get", help="print one or all settings")
+    get_parser.add_argument("field", nargs="?", choices=FIELDS.keys())
+    get_parser.add_argument("--mode", type=int, default=0, help="USB mode for usb_timing")
+
+    set_parser = commands.add_parser("set", help="change a setting")
+    set_parser.add_argument("field", choices=FIELDS.keys())
+    set_parser.add_argument("values", nargs="+", type=int)
+    set_parser.add_argument("--mode", type=int, default=0, help="USB mode for usb_timing")
+
+    commands.add_parser("commit", help="write the settings to flash")
+
+    stream_parser = commands.add_parser("stream", help="print raw and analog pad values, columns are raw/analog")
+    stream_parser.add_argument("--interval", type=int, default=10, help="interval in ms")
+    stream_parser.add_argument("--count", type=int, default=0, help="stop after this many frames, 0 runs forever")
+
+    args = parser.parse_args()
+    config = ConfigInterface()
+
+    if args.command == "get":
+        if args.field:
+            print(" ".join(str(v) for v in config.get(args.field, args.mode)))
+        else:
+            print_all(config)
+    elif args.command == "set":
+        config.set(args.field, args.values, args.mode)
+    elif args.command == "commit":
+        config.commit()
+    elif args.command == "stream":
+        stream(config, args.interval, args.count)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except (LookupError, struct.error, OSError) as error:
+        print("doncon_config: %s" % error, file=sys.stderr)
+        sys.exit(1)
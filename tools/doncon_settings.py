@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Exports and imports all DonCon2040 settings as a binary file.
+
+The controller needs to run in Debug mode. The file holds the settings of all
+profiles and is checked by the controller before anything is changed, an
+import is stored to flash at once. Requires pyserial:
+
+    ./doncon_settings.py --port /dev/ttyACM0 export cabinet.bin
+    ./doncon_settings.py --port /dev/ttyACM1 import cabinet.bin
+
+The controller switches to the emulation mode of the imported settings right
+away, which ends the Debug mode if it differs.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+BLOB_MAGIC = 0x5D
+BLOB_HEADER = struct.Struct("<BBHI")
+
+
+def check_blob(blob):
+    if len(blob) < BLOB_HEADER.size:
+        raise ValueError("File too short")
+
+    magic, schema_version, length, crc = BLOB_HEADER.unpack_from(blob)
+    if magic != BLOB_MAGIC or length != len(blob) - BLOB_HEADER.size:
+        raise ValueError("Not a settings file")
+    if zlib.crc32(blob[BLOB_HEADER.size:]) != crc:
+        raise ValueError("Checksum mismatch")
+
+    return schema_version
+
+
+def read_response(ser, prefix):
+    while True:
+        raw = ser.readline()
+        if not raw:
+            raise TimeoutError("No response from controller")
+
+        line = raw.decode("ascii", errors="replace").strip()
+        if line.startswith(prefix):
+            return line[len(prefix):].strip()
+
+
+def export_settings(port, output):
+    import serial
+
+    with serial.Serial(port, timeout=5) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"e")
+        blob = bytes.fromhex(read_response(ser, "# settings"))
+
+    schema_version = check_blob(blob)
+    output.write(blob)
+    print("Exported %d bytes, schema version %d" % (len(blob), schema_version), file=sys.stderr)
+
+
+def import_settings(port, file):
+    import serial
+
+    blob = file.read()
+    check_blob(blob)
+
+    with serial.Serial(port, timeout=5) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"i" + blob.hex().encode("ascii") + b"\n")
+        if read_response(ser, "# import") != "ok":
+            raise ValueError("Controller rejected the settings")
+
+    print("Imported %d bytes" % len(blob), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", required=True, help="serial port of the controller in Debug mode")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    export_parser = commands.add_parser("export", help="write the settings of the controller to a file")
+    export_parser.add_argument("output", type=argparse.FileType("wb"))
+
+    import_parser = commands.add_parser("import", help="replace the settings of the controller with a file")
+    import_parser.add_argument("input", type=argparse.FileType("rb"))
+
+    args = parser.parse_args()
+
+    try:
+        if args.command == "export":
+            export_settings(args.port, args.output)
+        else:
+            import_settings(args.port, args.input)
+    except (ValueError, TimeoutError, OSError) as error:
+        print("doncon_settings: %s" % error, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Reports the SRAM usage of a DonCon2040 firmware image.
+
+Lists all functions which are executed from SRAM instead of flash, i.e. the ones
+placed via __not_in_flash_func() or DONCON_HOT_FUNC(), together with the overall
+split of the SRAM into data, bss, heap and stacks. Runs after every build, but
+can also be used manually:
+
+    ./sram_report.py --nm arm-none-eabi-nm build/DonCon2040.elf
+"""
+
+import argparse
+import subprocess
+import sys
+
+SRAM_START = 0x20000000
+SRAM_END = 0x20042000
+
+FUNCTION_TYPES = {"t", "T", "W", "w"}
+
+
+def read_symbols(nm, elf):
+    output = subprocess.run([nm, "--print-size", "--demangle", "--defined-only", elf],
+                            check=True, capture_output=True, text=True).stdout
+
+    functions = []
+    markers = {}
+    for line in output.splitlines():
+        # Symbols without a size lack the second column, demangled names may contain spaces.
+        fields = line.split(" ", 2)
+        if len(fields) < 3:
+            continue
+        if len(fields[1]) == 1:
+            address, size, kind, name = int(fields[0], 16), 0, fields[1], fields[2]
+        else:
+            kind, name = fields[2].split(" ", 1)
+            address, size = int(fields[0], 16), int(fields[1], 16)
+
+        if kind in FUNCTION_TYPES and SRAM_START <= address < SRAM_END and size:
+            functions.append((size, name))
+        markers[name] = address
+
+    return functions, markers
+
+
+def region_size(markers, start, end):
+    if start not in markers or end not in markers:
+        return None
+    return markers[end] - markers[start]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF file")
+    parser.add_argument("--nm", default="arm-none-eabi-nm", help="nm of the ARM toolchain")
+    parser.add_argument("--top", type=int, default=0, help="only list the largest functions, 0 lists all")
+    args = parser.parse_args()
+
+    functions, markers = read_symbols(args.nm, args.elf)
+    functions.sort(reverse=True)
+
+    print("Functions in SRAM:")
+    for size, name in functions[:args.top] if args.top else functions:
+        print("%8d  %s" % (size, name))
+    print("%8d  total in %d functions" % (sum(size for size, _ in functions), len(functions)))
+
+    print("SRAM usage:")
+    regions = [
+        ("data", "__data_start__", "__data_end__"),  # Includes the functions above
+        ("bss", "__bss_start__", "__bss_end__"),
+        ("heap", "end", "__StackLimit"),
+        ("core0 stack", "__StackBottom", "__StackTop"),
+        ("core1 stack", "__StackOneBottom", "__StackOneTop"),
+    ]
+    for name, start, end in regions:
+        size = region_size(markers, start, end)
+        print("%8s  %s" % ("?" if size is None else size, name))
+    print("%8d  total" % (SRAM_END - SRAM_START))
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except (OSError, subprocess.CalledProcessError) as error:
+        print("sram_report: %s" % error, file=sys.stderr)
+        sys.exit(1)
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Converts a DonCon2040 trace dump to the Chrome trace event format.
+
+The firmware needs to be built with -DDONCON_TRACE=ON and run in Debug mode.
+Either read the dump directly from the controller's serial port, which
+requires pyserial:
+
+    ./trace_to_chrome.py --port /dev/ttyACM0 -o trace.json
+
+or convert a previously captured dump, i.e. the output of the 't' command:
+
+    ./trace_to_chrome.py dump.txt -o trace.json
+
+The result can be opened in chrome://tracing or https://ui.perfetto.dev.
+"""
+
+import argparse
+import json
+import sys
+
+
+def read_serial(port):
+    import serial
+
+    lines = []
+    with serial.Serial(port, timeout=5) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"t")
+
+        started = False
+        while True:
+            raw = ser.readline()
+            if not raw:
+                raise TimeoutError("No complete trace received")
+
+            line = raw.decode("ascii", errors="replace").strip()
+            if line == "# trace begin":
+                started = True
+            elif line == "# trace end":
+                return lines
+            elif started:
+                lines.append(line)
+
+
+def read_file(file):
+    lines = []
+    started = False
+    for line in file:
+        line = line.strip()
+        if line == "# trace begin":
+            started = True
+            lines = []
+        elif line == "# trace end":
+            return lines
+        elif started:
+            lines.append(line)
+
+    raise ValueError("No complete trace found in input")
+
+
+def convert(lines):
+    event_names = {}
+    task_names = {}
+    entries = []
+
+    for line in lines:
+        fields = line.split(" ", 5)
+        if fields[0] == "N" and len(fields) == 3:
+            event_names[int(fields[1])] = fields[2]
+        elif fields[0] == "T" and len(fields) == 3:
+            task_names[int(fields[1])] = fields[2]
+        elif fields[0] == "E" and len(fields) == 6:
+            core, timestamp, event_id, phase, arg = fields[1:]
+            entries.append((int(core), int(timestamp), int(event_id), phase, int(arg)))
+
+    # Timestamps are 32 bit microseconds, unwrap them per core.
+    unwrapped = []
+    for core in sorted({entry[0] for entry in entries}):
+        offset = 0
+        previous = None
+        for entry in (e for e in entries if e[0] == core):
+            timestamp = entry[1]
+            if previous is not None and timestamp + offset < previous - (1 << 31):
+                offset += 1 << 32
+            previous = timestamp + offset
+            unwrapped.append((core, previous) + entry[2:])
+
+    if not unwrapped:
+        return {"traceEvents": []}
+
+    start = min(entry[1] for entry in unwrapped)
+
+    trace_events = []
+    for core, timestamp, event_id, phase, arg in sorted(unwrapped, key=lambda e: e[1]):
+        name = event_names.get(event_id, "event_%d" % event_id)
+        if name == "task":
+            name = task_names.get(arg, "task_%d" % arg)
+
+        event = {
+            "name": name,
+            "ph": phase,
+            "ts": timestamp - start,
+            "pid": 0,
+            "tid": core,
+            "args": {"arg": arg},
+        }
+        if phase == "i":
+            event["s"] = "t"
+        trace_events.append(event)
+
+    for core in sorted({entry[0] for entry in unwrapped}):
+        trace_events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": core, "args": {"name": "core%d" % core}})
+
+    return {"traceEvents": trace_events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", type=argparse.FileType("r"), default=sys.stdin,
+                        help="captured trace dump, defaults to stdin")
+    parser.add_argument("--port", help="serial port of the controller in Debug mode")
+    parser.add_argument("-o", "--output", type=argparse.FileType("w"), default=sys.stdout,
+                        help="output file, defaults to stdout")
+    args = parser.parse_args()
+
+    lines = read_serial(args.port) if args.port else read_file(args.input)
+    json.dump(convert(lines), args.output)
+
+
+if __name__ == "__main__":
+    main()